@@ -0,0 +1,583 @@
+/**
+ * @file density_bench.c
+ * @brief Per-container runtime overhead at increasing container counts
+ *
+ * For each step, starts N idle containers with tinydocker, waits until all
+ * of them are recorded as running in the state store, then measures what the
+ * runtime itself costs per container:
+ * - RSS and PSS of the supervisor (tinydocker main) and of the container
+ *   init (the forked parent waiting in init_container); the idle workload
+ *   is not counted
+ * - kernel memory charged to tinydocker: the supervisors run in a cgroup
+ *   created by the benchmark, and the growth of its memory.stat kernel
+ *   value covers the supervisors and everything the container inits
+ *   allocate before being moved to their own cgroup (task, namespaces)
+ * - kernel memory charged to the container cgroups, which also includes
+ *   the mounts and the idle workload
+ * - open file descriptors of the supervisor and container init
+ * - launch and teardown throughput, and supervisors that failed to clean up
+ *
+ * Results are written to a tab-separated report so that overhead can be
+ * compared from one release to the next. Must be run as root.
+ *
+ * Usage: density_bench [-b BINARY] [-r ROOTFS] [-s STEPS] [-o REPORT]
+ *                      [-- IDLE_COMMAND [ARGS...]]
+ */
+
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/utsname.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/cgroup/cgroup.h"
+#include "../src/state/state.h"
+
+#ifndef VERSION
+#    define VERSION "?.?.?"
+#endif
+
+#define DEFAULT_BINARY "./build/bin/tinydocker"
+#define DEFAULT_ROOTFS "./rootfs"
+#define DEFAULT_STEPS "1,10,100,1000"
+#define MAX_STEPS 16
+
+/** @brief Cgroup holding the supervisors, suffixed with the benchmark PID */
+#define BENCH_CGROUP_PREFIX CGROUP_BASE_PATH "/density_bench-"
+
+/** @brief Time allowed for a single container to start, in seconds */
+#define LAUNCH_TIMEOUT_PER_CONTAINER 0.5
+#define LAUNCH_TIMEOUT_MIN 10.0
+
+/**
+ * @brief Measurements of one step
+ */
+typedef struct
+{
+    int containers; /**< Number of containers */
+    double launch_s; /**< Time until all containers were running */
+    double teardown_s; /**< Time until all supervisors exited */
+    long supervisor_rss_kb; /**< Total supervisor RSS */
+    long supervisor_pss_kb; /**< Total supervisor PSS */
+    long init_rss_kb; /**< Total container init RSS */
+    long init_pss_kb; /**< Total container init PSS */
+    long runtime_kernel_kb; /**< Growth of the benchmark cgroup kernel
+                               memory, -1 if unavailable */
+    long container_kernel_kb; /**< Total container cgroup kernel memory,
+                                 including the workload, -1 if unavailable */
+    long fds; /**< Total supervisor and container init descriptors */
+    int teardown_failures; /**< Supervisors that did not exit cleanly */
+} StepResult;
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int compare_pid(const void *a, const void *b)
+{
+    pid_t x = *(const pid_t *)a;
+    pid_t y = *(const pid_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Reads the Rss and Pss totals of a process, in kB
+static void read_smaps_rollup(pid_t pid, long *rss_kb, long *pss_kb)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/smaps_rollup", (int)pid);
+
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return;
+
+    char line[256];
+    long value;
+    while (fgets(line, sizeof(line), f))
+    {
+        if (sscanf(line, "Rss: %ld kB", &value) == 1)
+            *rss_kb += value;
+        else if (sscanf(line, "Pss: %ld kB", &value) == 1)
+            *pss_kb += value;
+    }
+
+    fclose(f);
+}
+
+static long count_fds(pid_t pid)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/fd", (int)pid);
+
+    DIR *dir = opendir(path);
+    if (!dir)
+        return 0;
+
+    long count = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if (entry->d_name[0] != '.')
+            count++;
+    }
+
+    closedir(dir);
+    return count;
+}
+
+// Kernel memory charged to a cgroup in kB, or -1 if memory.stat is missing.
+// Uses the "kernel" total when the kernel provides it, and sums its main
+// components otherwise.
+static long read_kernel_kb(const char *cgroup_path)
+{
+    char path[STATE_PATH_MAX + 16];
+    snprintf(path, sizeof(path), "%s/memory.stat", cgroup_path);
+
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return -1;
+
+    static const char *const components[] = {
+        "kernel_stack", "pagetables", "percpu", "sock", "slab",
+    };
+
+    char key[64];
+    long long value;
+    long long total = -1;
+    long long sum = 0;
+    while (fscanf(f, "%63s %lld", key, &value) == 2)
+    {
+        if (strcmp(key, "kernel") == 0)
+            total = value;
+        for (size_t i = 0; i < sizeof(components) / sizeof(components[0]);
+             i++)
+        {
+            if (strcmp(key, components[i]) == 0)
+                sum += value;
+        }
+    }
+
+    fclose(f);
+    return (long)((total >= 0 ? total : sum) / 1024);
+}
+
+// Formats a per-container kernel memory value, negative if unavailable
+static void format_kb(char *buf, size_t size, double kb)
+{
+    if (kb < 0)
+        snprintf(buf, size, "n/a");
+    else
+        snprintf(buf, size, "%.0fkB", kb);
+}
+
+static pid_t spawn_container(const char *binary, const char *rootfs,
+                             char **idle_cmd, int idle_argc,
+                             const char *bench_cgroup)
+{
+    pid_t pid = fork();
+    if (pid != 0)
+        return pid;
+
+    // Join the benchmark cgroup before exec so that everything the
+    // supervisor allocates is charged to it
+    char procs[STATE_PATH_MAX + 16];
+    snprintf(procs, sizeof(procs), "%s/cgroup.procs", bench_cgroup);
+    int procs_fd = open(procs, O_WRONLY | O_CLOEXEC);
+    if (procs_fd == -1 || write(procs_fd, "0", 1) != 1)
+    {
+        fprintf(stderr, "Error: Failed to join %s: %s\n", bench_cgroup,
+                strerror(errno));
+        _exit(EXIT_FAILURE);
+    }
+    close(procs_fd);
+
+    int null_fd = open("/dev/null", O_RDWR);
+    if (null_fd != -1)
+    {
+        dup2(null_fd, STDIN_FILENO);
+        dup2(null_fd, STDOUT_FILENO);
+        dup2(null_fd, STDERR_FILENO);
+        if (null_fd > STDERR_FILENO)
+            close(null_fd);
+    }
+
+    char **argv = calloc(idle_argc + 7, sizeof(char *));
+    if (!argv)
+        _exit(EXIT_FAILURE);
+
+    int argc = 0;
+    argv[argc++] = (char *)binary;
+    argv[argc++] = "-r";
+    argv[argc++] = (char *)rootfs;
+    argv[argc++] = "-h";
+    argv[argc++] = "density";
+    argv[argc++] = "--";
+    for (int i = 0; i < idle_argc; i++)
+        argv[argc++] = idle_cmd[i];
+
+    execv(binary, argv);
+    _exit(EXIT_FAILURE);
+}
+
+// Collects the records of the given supervisors, returns how many are running
+static int collect_records(const pid_t *supervisors, int count,
+                           ContainerRecord *records)
+{
+    StateStore *store = state_open(STATE_PATH, 0);
+    if (!store)
+        return -1;
+
+    int found = 0;
+    ContainerRecord record;
+    for (int i = 0; i < STATE_MAX_RECORDS && found < count; i++)
+    {
+        if (state_read(store, i, &record) && record.status == STATE_RUNNING
+            && bsearch(&record.supervisor_pid, supervisors, count,
+                       sizeof(pid_t), compare_pid))
+            records[found++] = record;
+    }
+
+    state_close(store);
+    return found;
+}
+
+// Kills every live container recorded for the given supervisors, whatever
+// its status
+static void kill_containers(const pid_t *supervisors, int count)
+{
+    StateStore *store = state_open(STATE_PATH, 0);
+    if (!store)
+        return;
+
+    ContainerRecord record;
+    for (int i = 0; i < STATE_MAX_RECORDS; i++)
+    {
+        if (state_read(store, i, &record)
+            && bsearch(&record.supervisor_pid, supervisors, count,
+                       sizeof(pid_t), compare_pid)
+            && state_process_alive(record.pid, record.start_time))
+            kill(record.pid, SIGKILL);
+    }
+
+    state_close(store);
+}
+
+// Stops the containers and their supervisors. Killing only a supervisor
+// would leave its container running.
+static void stop_all(pid_t *supervisors, int count)
+{
+    qsort(supervisors, count, sizeof(pid_t), compare_pid);
+
+    kill_containers(supervisors, count);
+    for (int i = 0; i < count; i++)
+        kill(supervisors[i], SIGKILL);
+    for (int i = 0; i < count; i++)
+        waitpid(supervisors[i], NULL, 0);
+
+    // An init released between the two passes is recorded before its
+    // release. Inits never released exit once their supervisor is gone.
+    kill_containers(supervisors, count);
+}
+
+static int run_step(int n, const char *binary, const char *rootfs,
+                    char **idle_cmd, int idle_argc, const char *bench_cgroup,
+                    StepResult *result)
+{
+    pid_t *supervisors = calloc(n, sizeof(pid_t));
+    ContainerRecord *records = calloc(n, sizeof(ContainerRecord));
+    if (!supervisors || !records)
+    {
+        fprintf(stderr, "Error: calloc failed: %s\n", strerror(errno));
+        free(supervisors);
+        free(records);
+        return EXIT_FAILURE;
+    }
+
+    memset(result, 0, sizeof(*result));
+    result->containers = n;
+    long kernel_before = read_kernel_kb(bench_cgroup);
+
+    // Launch
+    double start = now_s();
+    int spawned = 0;
+    for (; spawned < n; spawned++)
+    {
+        supervisors[spawned] = spawn_container(binary, rootfs, idle_cmd,
+                                               idle_argc, bench_cgroup);
+        if (supervisors[spawned] < 0)
+        {
+            fprintf(stderr, "Error: fork failed: %s\n", strerror(errno));
+            stop_all(supervisors, spawned);
+            free(supervisors);
+            free(records);
+            return EXIT_FAILURE;
+        }
+    }
+    qsort(supervisors, n, sizeof(pid_t), compare_pid);
+
+    double timeout = n * LAUNCH_TIMEOUT_PER_CONTAINER;
+    if (timeout < LAUNCH_TIMEOUT_MIN)
+        timeout = LAUNCH_TIMEOUT_MIN;
+
+    int running = 0;
+    while ((running = collect_records(supervisors, n, records)) < n)
+    {
+        // A supervisor exiting early means the launch failed
+        if (waitpid(-1, NULL, WNOHANG) > 0 || now_s() - start > timeout)
+        {
+            fprintf(stderr,
+                    "Error: only %d of %d containers started, run "
+                    "tinydocker manually to see why\n",
+                    running < 0 ? 0 : running, n);
+            stop_all(supervisors, n);
+            free(supervisors);
+            free(records);
+            return EXIT_FAILURE;
+        }
+        usleep(1000);
+    }
+    result->launch_s = now_s() - start;
+
+    // Measure the idle containers
+    for (int i = 0; i < n; i++)
+    {
+        read_smaps_rollup(records[i].supervisor_pid,
+                          &result->supervisor_rss_kb,
+                          &result->supervisor_pss_kb);
+        read_smaps_rollup(records[i].pid, &result->init_rss_kb,
+                          &result->init_pss_kb);
+        result->fds +=
+            count_fds(records[i].supervisor_pid) + count_fds(records[i].pid);
+
+        long kernel_kb = read_kernel_kb(records[i].cgroup_path);
+        if (kernel_kb < 0 || result->container_kernel_kb < 0)
+            result->container_kernel_kb = -1;
+        else
+            result->container_kernel_kb += kernel_kb;
+    }
+
+    long kernel_after = read_kernel_kb(bench_cgroup);
+    result->runtime_kernel_kb = kernel_before < 0 || kernel_after < 0
+                                    ? -1
+                                    : kernel_after - kernel_before;
+
+    // Teardown: killing the container init ends its PID namespace, then the
+    // supervisor cleans up and exits
+    start = now_s();
+    for (int i = 0; i < n; i++)
+        kill(records[i].pid, SIGKILL);
+    for (int i = 0; i < n; i++)
+    {
+        // A failed cgroup or state cleanup makes the supervisor exit with
+        // an error
+        int status;
+        if (waitpid(supervisors[i], &status, 0) == -1 || !WIFEXITED(status)
+            || WEXITSTATUS(status) != EXIT_SUCCESS)
+            result->teardown_failures++;
+    }
+    result->teardown_s = now_s() - start;
+
+    free(supervisors);
+    free(records);
+    return EXIT_SUCCESS;
+}
+
+static void print_usage(const char *program_name)
+{
+    printf("Usage: %s [OPTIONS] [-- IDLE_COMMAND [ARGS...]]\n\n",
+           program_name);
+    printf("Options:\n");
+    printf("  -b PATH    tinydocker binary (default: %s)\n", DEFAULT_BINARY);
+    printf("  -r PATH    Root filesystem (default: %s)\n", DEFAULT_ROOTFS);
+    printf("  -s LIST    Container counts (default: %s)\n", DEFAULT_STEPS);
+    printf("  -o PATH    Report file (default: density-%s.tsv)\n", VERSION);
+    printf("\nThe idle command defaults to /bin/sleep 86400.\n");
+}
+
+int main(int argc, char *argv[])
+{
+    const char *binary = DEFAULT_BINARY;
+    const char *rootfs = DEFAULT_ROOTFS;
+    char steps_arg[256] = DEFAULT_STEPS;
+    const char *report_path = "density-" VERSION ".tsv";
+
+    int opt;
+    while ((opt = getopt(argc, argv, "b:r:s:o:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'b':
+            binary = optarg;
+            break;
+        case 'r':
+            rootfs = optarg;
+            break;
+        case 's':
+            snprintf(steps_arg, sizeof(steps_arg), "%s", optarg);
+            break;
+        case 'o':
+            report_path = optarg;
+            break;
+        default:
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    static char *default_idle[] = { "/bin/sleep", "86400" };
+    char **idle_cmd = default_idle;
+    int idle_argc = 2;
+    if (optind < argc)
+    {
+        idle_cmd = &argv[optind];
+        idle_argc = argc - optind;
+    }
+
+    int steps[MAX_STEPS];
+    int nsteps = 0;
+    for (char *tok = strtok(steps_arg, ","); tok && nsteps < MAX_STEPS;
+         tok = strtok(NULL, ","))
+    {
+        steps[nsteps] = atoi(tok);
+        if (steps[nsteps] <= 0)
+        {
+            fprintf(stderr, "Error: invalid container count '%s'\n", tok);
+            return EXIT_FAILURE;
+        }
+        nsteps++;
+    }
+
+    if (access(binary, X_OK) != 0)
+    {
+        fprintf(stderr, "Error: %s is not executable: %s\n", binary,
+                strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    // Each container holds a few descriptors in the supervisor
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0)
+    {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    // Supervisors of every step run in this cgroup, see run_step()
+    char bench_cgroup[STATE_PATH_MAX];
+    snprintf(bench_cgroup, sizeof(bench_cgroup), "%s%d", BENCH_CGROUP_PREFIX,
+             (int)getpid());
+    if (mkdir(bench_cgroup, 0755) != 0)
+    {
+        fprintf(stderr, "Error: Failed to create %s: %s\n", bench_cgroup,
+                strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    FILE *report = fopen(report_path, "w");
+    if (!report)
+    {
+        fprintf(stderr, "Error: Failed to open %s: %s\n", report_path,
+                strerror(errno));
+        rmdir(bench_cgroup);
+        return EXIT_FAILURE;
+    }
+
+    struct utsname uts;
+    uname(&uts);
+    time_t now = time(NULL);
+    char date[32];
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+    fprintf(report, "# tinydocker density report\n");
+    fprintf(report, "# version: %s\n", VERSION);
+    fprintf(report, "# date: %s\n", date);
+    fprintf(report, "# kernel: %s %s\n", uts.release, uts.machine);
+    fprintf(report, "# idle command: %s\n", idle_cmd[0]);
+    fprintf(report, "# per-container values are means; "
+                    "teardown_failures is a count\n");
+    fprintf(report, "# runtime_kernel_kb: growth of the kernel memory of the "
+                    "cgroup running the supervisors, including what the "
+                    "inits allocate before joining their own cgroup\n");
+    fprintf(report, "# container_kernel_kb: kernel memory of the container "
+                    "cgroups, including mounts and the idle command\n");
+    fprintf(report, "# kernel memory is -1 when memory.stat is "
+                    "unavailable\n");
+    fprintf(report,
+            "containers\tlaunch_per_s\tteardown_per_s\tsupervisor_rss_kb\t"
+            "supervisor_pss_kb\tinit_rss_kb\tinit_pss_kb\truntime_pss_kb\t"
+            "runtime_kernel_kb\tcontainer_kernel_kb\tfds\t"
+            "teardown_failures\n");
+
+    printf("%-10s %10s %10s %10s %10s %10s %10s %10s %6s %6s\n",
+           "containers", "launch/s", "stop/s", "sup.PSS", "init.PSS",
+           "rt.PSS", "rt.kernel", "ct.kernel", "fds", "failed");
+
+    int status = EXIT_SUCCESS;
+    for (int i = 0; i < nsteps; i++)
+    {
+        StepResult r;
+        if (run_step(steps[i], binary, rootfs, idle_cmd, idle_argc,
+                     bench_cgroup, &r)
+            == EXIT_FAILURE)
+        {
+            status = EXIT_FAILURE;
+            break;
+        }
+
+        double n = (double)r.containers;
+        double runtime_kernel =
+            r.runtime_kernel_kb < 0 ? -1.0 : r.runtime_kernel_kb / n;
+        double container_kernel =
+            r.container_kernel_kb < 0 ? -1.0 : r.container_kernel_kb / n;
+        fprintf(report, "%d\t%.1f\t%.1f\t%.1f\t%.1f\t%.1f\t%.1f\t%.1f\t%.1f\t"
+                        "%.1f\t%.1f\t%d\n",
+                r.containers, n / r.launch_s, n / r.teardown_s,
+                r.supervisor_rss_kb / n, r.supervisor_pss_kb / n,
+                r.init_rss_kb / n, r.init_pss_kb / n,
+                (r.supervisor_pss_kb + r.init_pss_kb) / n, runtime_kernel,
+                container_kernel, r.fds / n, r.teardown_failures);
+        fflush(report);
+
+        char runtime_col[16];
+        char container_col[16];
+        format_kb(runtime_col, sizeof(runtime_col), runtime_kernel);
+        format_kb(container_col, sizeof(container_col), container_kernel);
+
+        printf("%-10d %10.1f %10.1f %8.0fkB %8.0fkB %8.0fkB %10s %10s %6.1f "
+               "%6d\n",
+               r.containers, n / r.launch_s, n / r.teardown_s,
+               r.supervisor_pss_kb / n, r.init_pss_kb / n,
+               (r.supervisor_pss_kb + r.init_pss_kb) / n, runtime_col,
+               container_col, r.fds / n, r.teardown_failures);
+
+        if (r.teardown_failures > 0)
+        {
+            fprintf(stderr,
+                    "Error: %d of %d supervisors failed to clean up, run "
+                    "tinydocker manually to see why\n",
+                    r.teardown_failures, r.containers);
+            status = EXIT_FAILURE;
+        }
+    }
+
+    fclose(report);
+    if (rmdir(bench_cgroup) != 0)
+    {
+        fprintf(stderr, "Warning: Failed to remove %s: %s\n", bench_cgroup,
+                strerror(errno));
+    }
+
+    printf("\nReport written to %s\n", report_path);
+    return status;
+}
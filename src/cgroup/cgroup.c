@@ -8,10 +8,9 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include "../trace/trace.h"
 #include "../utils/utils.h"
 
-#define CGROUP_BASE_PATH "/sys/fs/cgroup"
-
 CGroup *cgroup_create(const char *name, int max_cpus, long max_memory)
 {
     CGroup *cgroup = malloc(sizeof(CGroup));
@@ -136,6 +135,7 @@ int cgroup_apply_limits(CGroup *cgroup)
     }
 
     int status = EXIT_SUCCESS;
+    uint64_t span = trace_begin("cgroup_write_cpu_max");
     if (cgroup->max_cpus > 0)
     {
         status = write_str_to_file(path_to_cpu_max, "%d %d\n",
@@ -146,10 +146,14 @@ int cgroup_apply_limits(CGroup *cgroup)
         status = write_str_to_file(path_to_cpu_max, "max 100000\n");
     }
 
+    trace_end("cgroup_write_cpu_max", span);
+
     if (status == EXIT_SUCCESS)
     {
+        span = trace_begin("cgroup_write_memory_max");
         status =
             write_str_to_file(path_to_memory_max, "%ld\n", cgroup->max_memory);
+        trace_end("cgroup_write_memory_max", span);
     }
 
     free(path_to_cpu_max);
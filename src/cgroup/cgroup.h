@@ -8,6 +8,12 @@
 
 #include <sys/types.h>
 
+/** @brief Mount point of the cgroup v2 unified hierarchy */
+#define CGROUP_BASE_PATH "/sys/fs/cgroup"
+
+/** @brief Prefix of the per-container control group names */
+#define CGROUP_NAME_PREFIX "tinydocker-"
+
 /**
  * @brief Control group structure
  */
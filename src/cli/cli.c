@@ -8,6 +8,8 @@
 #include <string.h>
 
 #include "../container/container.h"
+#include "../seccomp/seccomp.h"
+#include "../trace/trace.h"
 
 #define DEFAULT_HOSTNAME "container"
 #define DEFAULT_ROOTFS "./rootfs"
@@ -16,7 +18,10 @@
 
 static void print_usage(const char *program_name)
 {
-    printf("Usage: %s [OPTIONS] -- COMMAND [ARGS...]\n\n", program_name);
+    printf("Usage: %s [OPTIONS] -- COMMAND [ARGS...]\n", program_name);
+    printf("       %s ps\n", program_name);
+    printf("       %s inspect ID\n", program_name);
+    printf("       %s prune\n\n", program_name);
     printf("Options:\n");
     printf("  -h, --hostname NAME   Set container hostname (default: %s)\n",
            DEFAULT_HOSTNAME);
@@ -26,31 +31,76 @@ static void print_usage(const char *program_name)
            DEFAULT_CPUS);
     printf("  -m, --memory SIZE     Set maximum memory in MB (default: %d)\n",
            (int)(DEFAULT_MEMORY / (1024 * 1024)));
+    printf("  --seccomp PROFILE     Syscall filter: %s, %s or a file "
+           "(default: %s)\n",
+           SECCOMP_PROFILE_DEFAULT, SECCOMP_PROFILE_UNCONFINED,
+           SECCOMP_PROFILE_UNCONFINED);
+    printf("  --trace FILE          Write a Chrome/Perfetto trace to FILE "
+           "(or set %s)\n",
+           TRACE_ENV_VAR);
     printf("  --help                Display this help message\n\n");
     printf("Examples:\n");
     printf("  # Run a basic container\n");
     printf("  sudo %s -- /bin/bash\n\n", program_name);
     printf("  # Run with custom hostname and resource limits\n");
-    printf("  sudo %s -h myapp -c 2 -m 1024 -- /bin/bash\n", program_name);
+    printf("  sudo %s -h myapp -c 2 -m 1024 -- /bin/bash\n\n", program_name);
+    printf("  # List running containers\n");
+    printf("  %s ps\n", program_name);
 }
 
-int parse_args(int argc, char *argv[], ContainerArgs *args)
+int parse_args(int argc, char *argv[], CliCommand *command,
+               ContainerArgs *args)
 {
     static struct option long_options[] = {
         { "hostname", required_argument, 0, 'h' },
         { "rootfs", required_argument, 0, 'r' },
         { "cpus", required_argument, 0, 'c' },
         { "memory", required_argument, 0, 'm' },
+        { "seccomp", required_argument, 0, 's' },
+        { "trace", required_argument, 0, 't' },
         { "help", no_argument, 0, '?' },
         { 0, 0, 0, 0 }
     };
 
     // Set default values
+    *command = CLI_RUN;
+    args->id = NULL;
     args->hostname = DEFAULT_HOSTNAME;
     args->rootfs = DEFAULT_ROOTFS;
     args->max_cpus = DEFAULT_CPUS;
     args->max_memory = DEFAULT_MEMORY;
     args->process = NULL;
+    args->seccomp_profile = SECCOMP_PROFILE_UNCONFINED;
+    args->seccomp = NULL;
+    args->sync_fd[0] = -1;
+    args->sync_fd[1] = -1;
+    args->trace_file = getenv(TRACE_ENV_VAR);
+    if (args->trace_file && args->trace_file[0] == '\0')
+        args->trace_file = NULL;
+
+    if (argc >= 2 && strcmp(argv[1], "ps") == 0)
+    {
+        *command = CLI_PS;
+        return EXIT_SUCCESS;
+    }
+
+    if (argc >= 2 && strcmp(argv[1], "prune") == 0)
+    {
+        *command = CLI_PRUNE;
+        return EXIT_SUCCESS;
+    }
+
+    if (argc >= 2 && strcmp(argv[1], "inspect") == 0)
+    {
+        if (argc != 3)
+        {
+            fprintf(stderr, "Usage: %s inspect ID\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+        *command = CLI_INSPECT;
+        args->id = argv[2];
+        return EXIT_SUCCESS;
+    }
 
     int opt;
     int option_index = 0;
@@ -84,6 +134,12 @@ int parse_args(int argc, char *argv[], ContainerArgs *args)
                 return EXIT_FAILURE;
             }
             break;
+        case 's':
+            args->seccomp_profile = optarg;
+            break;
+        case 't':
+            args->trace_file = optarg;
+            break;
         case '?':
             print_usage(argv[0]);
             return EXIT_FAILURE;
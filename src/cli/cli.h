@@ -8,17 +8,31 @@
 
 #include "../container/container.h"
 
+/**
+ * @brief tinydocker subcommand
+ */
+typedef enum
+{
+    CLI_RUN, /**< Run a container (default) */
+    CLI_PS, /**< List containers */
+    CLI_INSPECT, /**< Show the record of a container */
+    CLI_PRUNE /**< Remove stale records and control groups */
+} CliCommand;
+
 /**
  * @brief Parse command-line arguments
  *
  * Parses the command-line arguments and fills the ContainerArgs structure
  * with the configuration. If no command is specified, defaults to /bin/sh.
+ * For CLI_INSPECT, the container ID is stored in args->id.
  *
  * @param argc Number of command-line arguments
  * @param argv Array of command-line argument strings
+ * @param command Pointer to the CliCommand to fill
  * @param args Pointer to ContainerArgs structure to fill
  * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure
  */
-int parse_args(int argc, char *argv[], ContainerArgs *args);
+int parse_args(int argc, char *argv[], CliCommand *command,
+               ContainerArgs *args);
 
 #endif // TINYDOCKER_CLI_H
\ No newline at end of file
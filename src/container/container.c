@@ -13,21 +13,44 @@
 #include <sys/wait.h>
 #include <unistd.h>
 
+#include "../mount/mount.h"
+#include "../seccomp/seccomp.h"
+#include "../trace/trace.h"
+
 char child_stack[STACK_SIZE];
 
-int init_container(void *arg)
+/**
+ * @brief Set up the container and run the command
+ *
+ * @param args Pointer to the container configuration
+ * @return Exit status of the command, or EXIT_FAILURE on failure
+ */
+static int run_container(const ContainerArgs *args)
 {
-    ContainerArgs *args = (ContainerArgs *)arg;
-
     // Set hostname
-    if (sethostname(args->hostname, strlen(args->hostname)) != 0)
+    uint64_t span = trace_begin("sethostname");
+    int ret = sethostname(args->hostname, strlen(args->hostname));
+    trace_end("sethostname", span);
+    if (ret != 0)
     {
         fprintf(stderr, "Error: sethostname failed: %s\n", strerror(errno));
         return EXIT_FAILURE;
     }
 
+    // Build /proc, /dev, /sys and tmpfs mounts while host devices are visible
+    span = trace_begin("mount_setup");
+    ret = mount_setup(args->rootfs, args->max_memory);
+    trace_end("mount_setup", span);
+    if (ret != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
     // Change root directory
-    if (chroot(args->rootfs) != 0)
+    span = trace_begin("chroot");
+    ret = chroot(args->rootfs);
+    trace_end("chroot", span);
+    if (ret != 0)
     {
         fprintf(stderr, "Error: chroot failed: %s\n", strerror(errno));
         fprintf(stderr,
@@ -43,46 +66,38 @@ int init_container(void *arg)
         return EXIT_FAILURE;
     }
 
-    // Create /proc directory if it doesn't exist
-    if (mkdir("/proc", 0755) != 0 && errno != EEXIST)
-    {
-        fprintf(stderr, "Error: Failed to create /proc directory: %s\n",
-                strerror(errno));
-        return EXIT_FAILURE;
-    }
-
-    // Mount /proc
-    if (mount("proc", "/proc", "proc", 0, NULL) != 0)
-    {
-        fprintf(stderr, "Error: mount /proc failed: %s\n", strerror(errno));
-        return EXIT_FAILURE;
-    }
-
     // Fork to handle unmounting
+    span = trace_begin("fork");
     pid_t pid = fork();
     if (pid < 0)
     {
+        trace_end("fork", span);
         fprintf(stderr, "Error: fork failed: %s\n", strerror(errno));
-        if (umount2("/proc", MNT_DETACH) != 0)
-        {
-            fprintf(stderr, "Error: umount2 /proc failed: %s\n",
-                    strerror(errno));
-        }
+        mount_teardown();
         return EXIT_FAILURE;
     }
 
     if (pid == 0)
     {
         // Child process - execute the command
+        trace_process_start("container-process");
+
+        // Flush first and install the filter last, so that only the
+        // command runs under it
+        trace_instant("exec");
+        trace_flush();
+        if (args->seccomp
+            && seccomp_filter_install(args->seccomp, 0) == EXIT_FAILURE)
+        {
+            mount_teardown();
+            return EXIT_FAILURE;
+        }
+
         if (execvp(args->process[0], args->process) != 0)
         {
             fprintf(stderr, "Failed to execute %s: %s\n", args->process[0],
                     strerror(errno));
-            if (umount2("/proc", MNT_DETACH) != 0)
-            {
-                fprintf(stderr, "Error: umount2 /proc failed: %s\n",
-                        strerror(errno));
-            }
+            mount_teardown();
             return EXIT_FAILURE;
         }
         return EXIT_SUCCESS;
@@ -90,16 +105,60 @@ int init_container(void *arg)
     else
     {
         // Parent process - wait for child and unmount
+        trace_end("fork", span);
+        seccomp_filter_free(args->seccomp);
+
         int status;
+        span = trace_begin("child_wait");
         waitpid(pid, &status, 0);
+        trace_end("child_wait", span);
 
-        // Unmount /proc after child process ends
-        if (umount2("/proc", MNT_DETACH) != 0)
-        {
-            fprintf(stderr, "Error: umount2 /proc failed: %s\n",
-                    strerror(errno));
-        }
+        // Unmount the container filesystems after child process ends
+        span = trace_begin("mount_teardown");
+        mount_teardown();
+        trace_end("mount_teardown", span);
 
         return WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_FAILURE;
     }
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Wait until the supervisor has moved the init to its cgroup
+ *
+ * @param args Pointer to the container configuration
+ * @return EXIT_SUCCESS once released, EXIT_FAILURE if the supervisor is gone
+ */
+static int wait_for_cgroup(const ContainerArgs *args)
+{
+    close(args->sync_fd[1]);
+
+    char byte;
+    uint64_t span = trace_begin("cgroup_wait");
+    ssize_t ret = read(args->sync_fd[0], &byte, 1);
+    trace_end("cgroup_wait", span);
+    close(args->sync_fd[0]);
+
+    if (ret != 1)
+    {
+        fprintf(stderr, "Error: supervisor exited before the container "
+                        "started\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int init_container(void *arg)
+{
+    const ContainerArgs *args = (const ContainerArgs *)arg;
+
+    trace_process_start("container-init");
+
+    // Flush on every exit path, including errors, so that the trace shows
+    // the step that failed
+    int ret = wait_for_cgroup(args);
+    if (ret == EXIT_SUCCESS)
+        ret = run_container(args);
+    trace_flush();
+    return ret;
+}
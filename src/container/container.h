@@ -8,6 +8,8 @@
 
 #include <sys/types.h>
 
+#include "../seccomp/seccomp.h"
+
 /** @brief Size of the stack for the container process */
 #define STACK_SIZE (1024 * 1024)
 
@@ -19,20 +21,27 @@ extern char child_stack[STACK_SIZE];
  */
 typedef struct
 {
+    const char *id; /**< Container ID */
     const char *hostname; /**< Hostname for the container */
     const char *rootfs; /**< Path to the root filesystem */
     int max_cpus; /**< Maximum number of CPUs allowed */
     long max_memory; /**< Maximum memory allowed in bytes */
     char **process; /**< Command and arguments to execute */
+    const char *trace_file; /**< Trace output path, or NULL if disabled */
+    const char *seccomp_profile; /**< Seccomp profile name or path */
+    SeccompFilter *seccomp; /**< Compiled profile, or NULL if unconfined */
+    int sync_fd[2]; /**< Pipe written once the init is in its cgroup */
 } ContainerArgs;
 
 /**
  * @brief Initialize the container environment
  *
  * This function sets up the container environment by:
+ * - Waiting until the supervisor has moved it to its cgroup
  * - Setting the hostname
+ * - Mounting /proc, /dev, /sys, /tmp and /dev/shm (see mount_setup())
  * - Changing the root directory
- * - Mounting /proc
+ * - Installing the seccomp profile, if any
  * - Executing the specified command
  *
  * @param arg Pointer to ContainerArgs structure containing container
@@ -5,6 +5,7 @@
 
 #define _GNU_SOURCE
 #include <errno.h>
+#include <fcntl.h>
 #include <sched.h>
 #include <signal.h>
 #include <stdio.h>
@@ -14,11 +15,15 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "cgroup/cgroup.h"
 #include "cli/cli.h"
 #include "container/container.h"
+#include "state/state.h"
+#include "trace/trace.h"
+#include "utils/utils.h"
 
 #ifndef VERSION
 #    define VERSION "?.?.?"
@@ -27,16 +32,155 @@
 /** @brief Exit code for terminal process group errors */
 #define TTY_PG_FATAL_ERROR 2
 
+/**
+ * @brief Get the display status of a container record
+ *
+ * @param record Pointer to the container record
+ * @return Status name
+ */
+static const char *status_name(const ContainerRecord *record)
+{
+    if (record->pid > 0
+        && !state_process_alive(record->pid, record->start_time))
+        return "exited";
+
+    // Until a launch reconciles the record, check the supervisor here
+    if (!state_process_alive(record->supervisor_pid,
+                             record->supervisor_start_time))
+        return record->pid > 0 ? "orphaned" : "exited";
+
+    switch (record->status)
+    {
+    case STATE_CREATED:
+        return "created";
+    case STATE_RUNNING:
+        return "running";
+    case STATE_ORPHANED:
+        return "orphaned";
+    default:
+        return "unknown";
+    }
+}
+
+/**
+ * @brief List the recorded containers
+ *
+ * Reads the state store without locking, so listing never blocks launches.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ */
+static int list_containers(void)
+{
+    StateStore *store = state_open(STATE_PATH, 0);
+    if (!store)
+        return EXIT_FAILURE;
+
+    printf("%-14s %-8s %-9s %-5s %-8s %-16s %s\n", "CONTAINER ID", "PID",
+           "STATUS", "CPUS", "MEMORY", "HOSTNAME", "ROOTFS");
+
+    ContainerRecord record;
+    for (int i = 0; i < STATE_MAX_RECORDS; i++)
+    {
+        if (!state_read(store, i, &record))
+            continue;
+
+        printf("%-14s %-8d %-9s %-5d %-8ld %-16s %s\n", record.id,
+               record.pid, status_name(&record), record.max_cpus,
+               record.max_memory / (1024 * 1024), record.hostname,
+               record.rootfs);
+    }
+
+    state_close(store);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Print the record of a container
+ *
+ * @param id Container ID or unique ID prefix
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ */
+static int inspect_container(const char *id)
+{
+    StateStore *store = state_open(STATE_PATH, 0);
+    if (!store)
+        return EXIT_FAILURE;
+
+    ContainerRecord record;
+    int ret = state_find(store, id, &record);
+    state_close(store);
+    if (ret == EXIT_FAILURE)
+    {
+        fprintf(stderr, "Error: No such container or ambiguous ID: %s\n", id);
+        return EXIT_FAILURE;
+    }
+
+    char created[32] = "?";
+    time_t created_at = (time_t)record.created_at;
+    struct tm tm;
+    if (localtime_r(&created_at, &tm))
+        strftime(created, sizeof(created), "%Y-%m-%d %H:%M:%S", &tm);
+
+    printf("📦  Container %s:\n", record.id);
+    printf("├─  Status: %s\n", status_name(&record));
+    printf("├─  PID: %d (start time %llu)\n", record.pid, record.start_time);
+    printf("├─  Supervisor PID: %d (start time %llu)\n", record.supervisor_pid,
+           record.supervisor_start_time);
+    printf("├─  Hostname: %s\n", record.hostname);
+    printf("├─  Rootfs: %s\n", record.rootfs);
+    printf("├─  Cgroup: %s\n", record.cgroup_path);
+    printf("├─  Max CPUs: %d\n", record.max_cpus);
+    printf("├─  Max Memory: %ldMB\n", record.max_memory / (1024 * 1024));
+    printf("└─  Created: %s\n", created);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Remove stale records and control groups
+ *
+ * Checks every record, including those whose supervisor PID was reused,
+ * which the reconciliation done on each launch skips.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ */
+static int prune_containers(void)
+{
+    StateStore *store = state_open(STATE_PATH, 1);
+    if (!store)
+        return EXIT_FAILURE;
+
+    int ret = state_prune(store);
+    state_close(store);
+    return ret;
+}
+
+/**
+ * @brief Remove the record of a container and close the state store
+ *
+ * @param store Pointer to the StateStore structure
+ * @param slot Slot index returned by state_register()
+ */
+static void forget_container(StateStore *store, int slot)
+{
+    state_release(store, slot);
+    state_close(store);
+}
+
 /**
  * @brief Main program entry point
  *
  * The main function:
- * 1. Parses command-line arguments
+ * 1. Parses command-line arguments and enables tracing if requested
  * 2. Validates the root filesystem
- * 3. Creates a new container using clone
- * 4. Sets up cgroup limits
- * 5. Waits for the container to finish
- * 6. Cleans up resources
+ * 3. Reconciles the state store and records the container
+ * 4. Creates a new container using clone
+ * 5. Sets up cgroup limits
+ * 6. Waits for the container to finish
+ * 7. Cleans up resources
+ *
+ * The ps and inspect subcommands only read the state store, prune
+ * reconciles it.
  *
  * @param argc Number of command-line arguments
  * @param argv Array of command-line argument strings
@@ -44,15 +188,38 @@
  */
 int main(int argc, char *argv[])
 {
+    CliCommand command;
     ContainerArgs args;
 
-    if (parse_args(argc, argv, &args) == EXIT_FAILURE)
+    if (parse_args(argc, argv, &command, &args) == EXIT_FAILURE)
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (command == CLI_PS)
+        return list_containers();
+    if (command == CLI_INSPECT)
+        return inspect_container(args.id);
+    if (command == CLI_PRUNE)
+        return prune_containers();
+
+    char id[STATE_ID_LEN + 1];
+    if (state_new_id(id) == EXIT_FAILURE)
     {
         return EXIT_FAILURE;
     }
+    args.id = id;
+
+    if (args.trace_file)
+    {
+        if (trace_open(args.trace_file, args.id) == EXIT_FAILURE)
+            return EXIT_FAILURE;
+        atexit(trace_close);
+    }
 
     printf("🐟  tinydocker v%s\n\n", VERSION);
     printf("📦  Container config:\n");
+    printf("├─  ID: %s\n", args.id);
     printf("├─  Hostname: %s\n", args.hostname);
     printf("├─  Rootfs: %s\n", args.rootfs);
     printf("├─  Process: %s\n", args.process[0]);
@@ -60,8 +227,11 @@ int main(int argc, char *argv[])
     printf("└─  Max Memory: %ldMB\n\n", args.max_memory / (1024 * 1024));
 
     // Check if rootfs exists and is a directory
+    uint64_t span = trace_begin("rootfs_check");
     struct stat st;
-    if (stat(args.rootfs, &st) != 0)
+    int stat_ret = stat(args.rootfs, &st);
+    trace_end("rootfs_check", span);
+    if (stat_ret != 0)
     {
         fprintf(stderr, "Error: Root filesystem '%s' not found: %s\n",
                 args.rootfs, strerror(errno));
@@ -76,12 +246,73 @@ int main(int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
+    // Compile the seccomp profile up front so that profile errors are
+    // reported before anything is set up
+    if (strcmp(args.seccomp_profile, SECCOMP_PROFILE_UNCONFINED) != 0)
+    {
+        span = trace_begin("seccomp_compile");
+        args.seccomp = seccomp_filter_create(args.seccomp_profile);
+        trace_end("seccomp_compile", span);
+        if (!args.seccomp)
+            return EXIT_FAILURE;
+    }
+
+    // Recover from crashed supervisors, then record this container. Only
+    // dead owners are checked here, prune does the full pass.
+    span = trace_begin("state_reconcile");
+    StateStore *store = state_open(STATE_PATH, 1);
+    if (store)
+        state_reconcile(store);
+    trace_end("state_reconcile", span);
+    if (!store)
+    {
+        fprintf(stderr, "Error: state store unavailable\n");
+        return EXIT_FAILURE;
+    }
+
+    ContainerRecord record;
+    memset(&record, 0, sizeof(record));
+    snprintf(record.id, sizeof(record.id), "%s", args.id);
+    record.supervisor_pid = getpid();
+    record.supervisor_start_time = proc_start_time(record.supervisor_pid);
+    snprintf(record.cgroup_path, sizeof(record.cgroup_path), "%s/%s%s",
+             CGROUP_BASE_PATH, CGROUP_NAME_PREFIX, args.id);
+    snprintf(record.rootfs, sizeof(record.rootfs), "%s", args.rootfs);
+    snprintf(record.hostname, sizeof(record.hostname), "%s", args.hostname);
+    record.max_cpus = args.max_cpus;
+    record.max_memory = args.max_memory;
+    record.created_at = (long long)time(NULL);
+    record.status = STATE_CREATED;
+
+    int slot = state_register(store, &record);
+    if (slot == -1)
+    {
+        state_close(store);
+        return EXIT_FAILURE;
+    }
+
     printf("🚀 Starting container...\n");
     printf("\n");
 
+    // The init waits on this pipe until it has been moved to its cgroup, so
+    // that nothing it forks escapes the limits
+    if (pipe2(args.sync_fd, O_CLOEXEC) != 0)
+    {
+        fprintf(stderr, "Error: pipe failed: %s\n", strerror(errno));
+        forget_container(store, slot);
+        return EXIT_FAILURE;
+    }
+
+    span = trace_begin("clone");
     pid_t pid =
         clone(init_container, child_stack + STACK_SIZE,
               CLONE_NEWUTS | CLONE_NEWPID | CLONE_NEWNS | SIGCHLD, &args);
+    trace_end("clone", span);
+
+    // The container init has its own copy of the filter and of the pipe
+    seccomp_filter_free(args.seccomp);
+    args.seccomp = NULL;
+    close(args.sync_fd[0]);
 
     if (pid == -1)
     {
@@ -99,45 +330,86 @@ int main(int argc, char *argv[])
         {
             fprintf(stderr, "Error: clone failed: %s\n", strerror(errno));
         }
+        forget_container(store, slot);
         return EXIT_FAILURE;
     }
 
     printf("✅ Running container with PID %d:\n", pid);
 
     // Create and setup cgroup
-    CGroup *cgroup =
-        cgroup_create("tinydocker", args.max_cpus, args.max_memory);
+    // One cgroup per container, named after its ID
+    char cgroup_name[sizeof(CGROUP_NAME_PREFIX) + STATE_ID_LEN];
+    snprintf(cgroup_name, sizeof(cgroup_name), "%s%s", CGROUP_NAME_PREFIX,
+             args.id);
+
+    span = trace_begin("cgroup_create");
+    CGroup *cgroup = cgroup_create(cgroup_name, args.max_cpus, args.max_memory);
+    trace_end("cgroup_create", span);
     if (!cgroup)
     {
         fprintf(stderr, "Error: cgroup creation failed: %s\n", strerror(errno));
         kill(pid, SIGKILL);
+        forget_container(store, slot);
         return EXIT_FAILURE;
     }
 
-    if (cgroup_apply_limits(cgroup) == EXIT_FAILURE)
+    span = trace_begin("cgroup_apply_limits");
+    int ret = cgroup_apply_limits(cgroup);
+    trace_end("cgroup_apply_limits", span);
+    if (ret == EXIT_FAILURE)
     {
         fprintf(stderr, "Error: cgroup limits application failed: %s\n",
                 strerror(errno));
         cgroup_free(cgroup);
         kill(pid, SIGKILL);
+        forget_container(store, slot);
         return EXIT_FAILURE;
     }
 
-    if (cgroup_add_process(cgroup, pid) == EXIT_FAILURE)
+    span = trace_begin("cgroup_add_process");
+    ret = cgroup_add_process(cgroup, pid);
+    trace_end("cgroup_add_process", span);
+    if (ret == EXIT_FAILURE)
     {
         fprintf(stderr, "Error: cgroup process addition failed: %s\n",
                 strerror(errno));
         cgroup_free(cgroup);
         kill(pid, SIGKILL);
+        forget_container(store, slot);
+        return EXIT_FAILURE;
+    }
+
+    // Record the init before releasing it, so that every running init can
+    // be found in the state store. Only the supervisor can reap the init,
+    // so its PID cannot be reused before this point.
+    record.pid = pid;
+    record.start_time = proc_start_time(pid);
+    record.status = STATE_RUNNING;
+    state_update(store, slot, &record);
+
+    // Release the init. If the supervisor dies before this point, the init
+    // reads end of file and exits on its own.
+    if (write(args.sync_fd[1], "", 1) != 1)
+    {
+        fprintf(stderr, "Error: container release failed: %s\n",
+                strerror(errno));
+        cgroup_free(cgroup);
+        kill(pid, SIGKILL);
+        forget_container(store, slot);
         return EXIT_FAILURE;
     }
+    close(args.sync_fd[1]);
 
     int status;
-    if (waitpid(pid, &status, 0) == -1)
+    span = trace_begin("container_wait");
+    ret = waitpid(pid, &status, 0);
+    trace_end("container_wait", span);
+    if (ret == -1)
     {
         fprintf(stderr, "Error: container process wait failed: %s\n",
                 strerror(errno));
         cgroup_free(cgroup);
+        forget_container(store, slot);
         return EXIT_FAILURE;
     }
 
@@ -157,15 +429,20 @@ int main(int argc, char *argv[])
                 WTERMSIG(status));
     }
 
-    if (cgroup_destroy(cgroup) == EXIT_FAILURE)
+    span = trace_begin("cgroup_destroy");
+    ret = cgroup_destroy(cgroup);
+    trace_end("cgroup_destroy", span);
+    if (ret == EXIT_FAILURE)
     {
         fprintf(stderr, "Error: cgroup destruction failed: %s\n",
                 strerror(errno));
         cgroup_free(cgroup);
+        forget_container(store, slot);
         return EXIT_FAILURE;
     }
 
     cgroup_free(cgroup);
+    forget_container(store, slot);
 
     return EXIT_SUCCESS;
 }
\ No newline at end of file
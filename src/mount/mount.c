@@ -0,0 +1,294 @@
+#define _GNU_SOURCE
+#include "mount.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <linux/openat2.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "../trace/trace.h"
+
+#define MOUNT_DATA_MAX 128
+
+// Applied in order: parents must come before the entries they contain.
+static const MountEntry mount_table[] = {
+    { MOUNT_FS, "proc", "/proc", "proc", MS_NOSUID | MS_NODEV | MS_NOEXEC,
+      NULL, 0 },
+    // nodev: only the device nodes bind-mounted below, which carry their
+    // own flags, are usable
+    { MOUNT_FS, "tmpfs", "/dev", "tmpfs",
+      MS_NOSUID | MS_NODEV | MS_NOEXEC | MS_STRICTATIME,
+      "mode=755,size=65536", 0 },
+    { MOUNT_FS, "devpts", "/dev/pts", "devpts", MS_NOSUID | MS_NOEXEC,
+      "newinstance,ptmxmode=0666,mode=0620", 0 },
+    { MOUNT_FS, "shm", "/dev/shm", "tmpfs", MS_NOSUID | MS_NODEV | MS_NOEXEC,
+      "mode=1777", 25 },
+    { MOUNT_DEVICE, "/dev/null", "/dev/null", NULL, MS_NOSUID | MS_NOEXEC,
+      NULL, 0 },
+    { MOUNT_DEVICE, "/dev/zero", "/dev/zero", NULL, MS_NOSUID | MS_NOEXEC,
+      NULL, 0 },
+    { MOUNT_DEVICE, "/dev/full", "/dev/full", NULL, MS_NOSUID | MS_NOEXEC,
+      NULL, 0 },
+    { MOUNT_DEVICE, "/dev/random", "/dev/random", NULL,
+      MS_NOSUID | MS_NOEXEC, NULL, 0 },
+    { MOUNT_DEVICE, "/dev/urandom", "/dev/urandom", NULL,
+      MS_NOSUID | MS_NOEXEC, NULL, 0 },
+    { MOUNT_DEVICE, "/dev/tty", "/dev/tty", NULL, MS_NOSUID | MS_NOEXEC,
+      NULL, 0 },
+    { MOUNT_SYMLINK, "pts/ptmx", "/dev/ptmx", NULL, 0, NULL, 0 },
+    { MOUNT_SYMLINK, "/proc/self/fd", "/dev/fd", NULL, 0, NULL, 0 },
+    { MOUNT_SYMLINK, "/proc/self/fd/0", "/dev/stdin", NULL, 0, NULL, 0 },
+    { MOUNT_SYMLINK, "/proc/self/fd/1", "/dev/stdout", NULL, 0, NULL, 0 },
+    { MOUNT_SYMLINK, "/proc/self/fd/2", "/dev/stderr", NULL, 0, NULL, 0 },
+    { MOUNT_FS, "sysfs", "/sys", "sysfs",
+      MS_RDONLY | MS_NOSUID | MS_NODEV | MS_NOEXEC, NULL, 0 },
+    { MOUNT_FS, "tmpfs", "/tmp", "tmpfs", MS_NOSUID | MS_NODEV, "mode=1777",
+      50 },
+};
+
+#define MOUNT_TABLE_SIZE (sizeof(mount_table) / sizeof(mount_table[0]))
+
+// Resolves a path below the root filesystem, refusing symlinks in any
+// component so that the rootfs cannot redirect a mount onto the host
+static int open_beneath(int root, const char *path, int flags)
+{
+    struct open_how how = {
+        .flags = (unsigned long long)(flags | O_CLOEXEC),
+        .resolve = RESOLVE_BENEATH | RESOLVE_NO_SYMLINKS,
+    };
+
+    return (int)syscall(SYS_openat2, root, path[0] ? path : ".", &how,
+                        sizeof(how));
+}
+
+// Opens the parent directory of a table target and returns its last
+// component in name
+static int open_parent(int root, const char *target, const char **name)
+{
+    char parent[PATH_MAX];
+    const char *slash = strrchr(target, '/');
+
+    // Table targets are absolute, strip the leading slash
+    snprintf(parent, sizeof(parent), "%.*s", (int)(slash - target),
+             target + 1);
+    *name = slash + 1;
+
+    int fd = open_beneath(root, parent, O_PATH | O_DIRECTORY);
+    if (fd == -1)
+    {
+        fprintf(stderr, "Error: Failed to resolve %s: %s\n", target,
+                strerror(errno));
+    }
+    return fd;
+}
+
+// Path that mount(2) resolves to the file opened as fd
+static void fd_path(char *path, size_t size, int fd)
+{
+    snprintf(path, size, "/proc/self/fd/%d", fd);
+}
+
+static int mount_fs(const MountEntry *entry, int root, long max_memory)
+{
+    const char *name;
+    int parent = open_parent(root, entry->target, &name);
+    if (parent == -1)
+        return EXIT_FAILURE;
+
+    int ret = mkdirat(parent, name, 0755);
+    int fd = ret == 0 || errno == EEXIST
+                 ? open_beneath(root, entry->target + 1,
+                                O_PATH | O_DIRECTORY)
+                 : -1;
+    close(parent);
+    if (fd == -1)
+    {
+        fprintf(stderr, "Error: Failed to create %s directory: %s\n",
+                entry->target, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    char data[MOUNT_DATA_MAX];
+    const char *options = entry->data;
+    if (entry->size_percent > 0 && max_memory > 0)
+    {
+        ret = snprintf(data, sizeof(data), "%s,size=%ld", entry->data,
+                       max_memory / 100 * entry->size_percent);
+        if (ret < 0 || (size_t)ret >= sizeof(data))
+        {
+            fprintf(stderr, "Mount options too long\n");
+            close(fd);
+            return EXIT_FAILURE;
+        }
+        options = data;
+    }
+
+    char path[32];
+    fd_path(path, sizeof(path), fd);
+    ret = mount(entry->source, path, entry->fstype, entry->flags, options);
+    close(fd);
+    if (ret != 0)
+    {
+        fprintf(stderr, "Error: mount %s failed: %s\n", entry->target,
+                strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static int mount_device(const MountEntry *entry, int root)
+{
+    const char *name;
+    int parent = open_parent(root, entry->target, &name);
+    if (parent == -1)
+        return EXIT_FAILURE;
+
+    int fd = openat(parent, name, O_WRONLY | O_CREAT | O_NOFOLLOW | O_CLOEXEC,
+                    0666);
+    close(parent);
+    if (fd == -1)
+    {
+        fprintf(stderr, "Error: Failed to create %s: %s\n", entry->target,
+                strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    char path[32];
+    fd_path(path, sizeof(path), fd);
+    int ret = mount(entry->source, path, NULL, MS_BIND, NULL);
+    close(fd);
+    if (ret != 0)
+    {
+        fprintf(stderr, "Error: bind mount %s failed: %s\n", entry->target,
+                strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    // Bind mounts ignore most flags until remounted. Reopen the target so
+    // that the remount applies to the new bind mount.
+    fd = open_beneath(root, entry->target + 1, O_PATH);
+    if (fd == -1)
+    {
+        fprintf(stderr, "Error: Failed to resolve %s: %s\n", entry->target,
+                strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    fd_path(path, sizeof(path), fd);
+    ret = mount(NULL, path, NULL, MS_REMOUNT | MS_BIND | entry->flags, NULL);
+    close(fd);
+    if (ret != 0)
+    {
+        fprintf(stderr, "Error: remount %s failed: %s\n", entry->target,
+                strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static int mount_symlink(const MountEntry *entry, int root)
+{
+    const char *name;
+    int parent = open_parent(root, entry->target, &name);
+    if (parent == -1)
+        return EXIT_FAILURE;
+
+    int ret = symlinkat(entry->source, parent, name);
+    close(parent);
+    if (ret != 0 && errno != EEXIST)
+    {
+        fprintf(stderr, "Error: symlink %s failed: %s\n", entry->target,
+                strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int mount_setup(const char *rootfs, long max_memory)
+{
+    uint64_t start = trace_now();
+
+    // Keep container mounts from propagating back to the host
+    if (mount(NULL, "/", NULL, MS_REC | MS_PRIVATE, NULL) != 0)
+    {
+        fprintf(stderr, "Error: making / private failed: %s\n",
+                strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    // Every target is resolved relative to the rootfs, never through a path
+    int root = open(rootfs, O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (root == -1)
+    {
+        fprintf(stderr, "Error: open %s failed: %s\n", rootfs,
+                strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    int ret = EXIT_SUCCESS;
+    for (size_t i = 0; i < MOUNT_TABLE_SIZE && ret == EXIT_SUCCESS; i++)
+    {
+        const MountEntry *entry = &mount_table[i];
+
+        uint64_t span = trace_begin(entry->target);
+        switch (entry->kind)
+        {
+        case MOUNT_FS:
+            ret = mount_fs(entry, root, max_memory);
+            break;
+        case MOUNT_DEVICE:
+            ret = mount_device(entry, root);
+            break;
+        case MOUNT_SYMLINK:
+            ret = mount_symlink(entry, root);
+            break;
+        default:
+            ret = EXIT_FAILURE;
+            break;
+        }
+        trace_end(entry->target, span);
+    }
+
+    close(root);
+    if (ret == EXIT_FAILURE)
+        return EXIT_FAILURE;
+
+    uint64_t elapsed_us = (trace_now() - start) / 1000;
+    if (elapsed_us > MOUNT_SETUP_BUDGET_US)
+    {
+        fprintf(stderr,
+                "Warning: mount setup took %lluus (budget: %dus)\n",
+                (unsigned long long)elapsed_us, MOUNT_SETUP_BUDGET_US);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+void mount_teardown(void)
+{
+    for (size_t i = MOUNT_TABLE_SIZE; i-- > 0;)
+    {
+        const MountEntry *entry = &mount_table[i];
+        if (entry->kind == MOUNT_SYMLINK)
+            continue;
+
+        // Submounts may already be gone along with their parent
+        if (umount2(entry->target, MNT_DETACH | UMOUNT_NOFOLLOW) != 0
+            && errno != EINVAL
+            && errno != ENOENT)
+        {
+            fprintf(stderr, "Error: umount2 %s failed: %s\n", entry->target,
+                    strerror(errno));
+        }
+    }
+}
@@ -0,0 +1,67 @@
+/**
+ * @file mount.h
+ * @brief Container filesystem mount setup
+ */
+
+#ifndef TINYDOCKER_MOUNT_H
+#define TINYDOCKER_MOUNT_H
+
+/** @brief Start latency budget for the whole mount setup, in microseconds */
+#define MOUNT_SETUP_BUDGET_US 5000
+
+/**
+ * @brief Kind of a mount table entry
+ */
+typedef enum
+{
+    MOUNT_FS, /**< Mount a filesystem on a directory */
+    MOUNT_DEVICE, /**< Bind-mount a host device node */
+    MOUNT_SYMLINK /**< Create a symbolic link */
+} MountKind;
+
+/**
+ * @brief Mount table entry
+ */
+typedef struct
+{
+    MountKind kind; /**< Kind of entry */
+    const char *source; /**< Filesystem source, host device or link target */
+    const char *target; /**< Path inside the container */
+    const char *fstype; /**< Filesystem type (MOUNT_FS only) */
+    unsigned long flags; /**< Mount flags */
+    const char *data; /**< Filesystem options */
+    int size_percent; /**< tmpfs size as a percentage of the memory limit */
+} MountEntry;
+
+/**
+ * @brief Build the container mount set
+ *
+ * Makes the mount namespace private, then applies the mount table in a
+ * single pass below the root filesystem:
+ * - /proc
+ * - a tmpfs /dev with whitelisted device nodes bind-mounted from the host
+ * - /dev/pts as a new devpts instance and a size-limited /dev/shm
+ * - a read-only /sys
+ * - a size-limited /tmp
+ *
+ * Targets are resolved relative to the root filesystem with symlinks
+ * refused in every path component, so a crafted rootfs cannot redirect a
+ * mount outside of it. Must be called before chroot, as device nodes and
+ * /proc/self/fd are taken from the host.
+ * A warning is printed if the setup exceeds MOUNT_SETUP_BUDGET_US.
+ *
+ * @param rootfs Path to the root filesystem
+ * @param max_memory Container memory limit in bytes, used to size tmpfs
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ */
+int mount_setup(const char *rootfs, long max_memory);
+
+/**
+ * @brief Unmount the container mount set
+ *
+ * Lazily unmounts every mount of the table in reverse order. Must be called
+ * after chroot.
+ */
+void mount_teardown(void);
+
+#endif // TINYDOCKER_MOUNT_H
@@ -0,0 +1,488 @@
+#define _GNU_SOURCE
+#include "seccomp.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <linux/audit.h>
+#include <linux/seccomp.h>
+#include <sched.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "syscalls.h"
+
+// 64-bit architectures only: the default allowlist has none of the 32-bit
+// variants (mmap2, fstat64, _llseek, socketcall...)
+#if defined(__x86_64__)
+#    define SECCOMP_AUDIT_ARCH AUDIT_ARCH_X86_64
+#elif defined(__aarch64__)
+#    define SECCOMP_AUDIT_ARCH AUDIT_ARCH_AARCH64
+#elif defined(__riscv) && __riscv_xlen == 64
+#    define SECCOMP_AUDIT_ARCH AUDIT_ARCH_RISCV64
+#else
+#    error "seccomp: unsupported architecture"
+#endif
+
+/** @brief First syscall number of the x32 ABI, which shares the x86_64 arch */
+#define X32_SYSCALL_BIT 0x40000000
+
+// ENOSYS rather than EPERM, so that libc and runtimes fall back to older
+// syscalls instead of failing
+#define SECCOMP_RET_DENY (SECCOMP_RET_ERRNO | (ENOSYS & SECCOMP_RET_DATA))
+
+#define SECCOMP_RET_EPERM (SECCOMP_RET_ERRNO | (EPERM & SECCOMP_RET_DATA))
+
+/** @brief clone flags creating namespaces */
+#define CLONE_NAMESPACE_FLAGS                                                \
+    (CLONE_NEWNS | CLONE_NEWCGROUP | CLONE_NEWUTS | CLONE_NEWIPC            \
+     | CLONE_NEWUSER | CLONE_NEWPID | CLONE_NEWNET)
+
+/** @brief Offset of the low 32 bits of a syscall argument */
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#    define SECCOMP_ARG_LO(n) (offsetof(struct seccomp_data, args[n]) + 4)
+#else
+#    define SECCOMP_ARG_LO(n) offsetof(struct seccomp_data, args[n])
+#endif
+
+/** @brief Instructions emitted per binary search node */
+#define NODE_INSNS 4
+
+// Syscalls needed by common shells, language runtimes and daemons. Names
+// unknown on the build architecture are skipped.
+static const char *const default_allowlist[] = {
+    "accept", "accept4", "access", "adjtimex", "alarm", "arch_prctl", "bind",
+    "brk", "capget", "capset", "chdir", "chmod", "chown", "clock_adjtime",
+    "clock_getres", "clock_gettime", "clock_nanosleep", "clone", "clone3",
+    "close", "close_range", "connect", "copy_file_range", "creat", "dup",
+    "dup2", "dup3", "epoll_create", "epoll_create1", "epoll_ctl",
+    "epoll_pwait", "epoll_pwait2", "epoll_wait", "eventfd", "eventfd2",
+    "execve", "execveat", "exit", "exit_group", "faccessat", "faccessat2",
+    "fadvise64", "fallocate", "fchdir", "fchmod", "fchmodat", "fchown",
+    "fchownat", "fcntl", "fdatasync", "fgetxattr", "flistxattr", "flock",
+    "fork", "fremovexattr", "fsetxattr", "fstat", "fstatfs", "fsync",
+    "ftruncate", "futex", "futex_waitv", "futimesat", "get_robust_list",
+    "get_thread_area", "getcpu", "getcwd", "getdents", "getdents64",
+    "getegid", "geteuid", "getgid", "getgroups", "getitimer", "getpeername",
+    "getpgid", "getpgrp", "getpid", "getppid", "getpriority", "getrandom",
+    "getresgid", "getresuid", "getrlimit", "getrusage", "getsid",
+    "getsockname", "getsockopt", "gettid", "gettimeofday", "getuid",
+    "getxattr", "inotify_add_watch", "inotify_init", "inotify_init1",
+    "inotify_rm_watch", "io_cancel", "io_destroy", "io_getevents",
+    "io_pgetevents", "io_setup", "io_submit", "ioctl", "ioprio_get",
+    "ioprio_set", "kill", "lchown", "lgetxattr", "link", "linkat", "listen",
+    "listxattr", "llistxattr", "lremovexattr", "lseek", "lsetxattr", "lstat",
+    "madvise", "membarrier", "memfd_create", "mincore", "mkdir", "mkdirat",
+    "mknod", "mknodat", "mlock", "mlock2", "mlockall", "mmap", "mprotect",
+    "mq_getsetattr", "mq_notify", "mq_open", "mq_timedreceive",
+    "mq_timedsend", "mq_unlink", "mremap", "msgctl", "msgget", "msgrcv",
+    "msgsnd", "msync", "munlock", "munlockall", "munmap", "nanosleep",
+    "newfstatat", "open", "openat", "openat2", "pause", "pidfd_getfd",
+    "pidfd_open", "pidfd_send_signal", "pipe", "pipe2", "pkey_alloc",
+    "pkey_free", "pkey_mprotect", "poll", "ppoll", "prctl", "pread64",
+    "preadv", "preadv2", "prlimit64", "pselect6", "pwrite64", "pwritev",
+    "pwritev2", "read", "readahead", "readlink", "readlinkat", "readv",
+    "recvfrom", "recvmmsg", "recvmsg", "remap_file_pages", "removexattr",
+    "rename", "renameat", "renameat2", "restart_syscall", "rmdir", "rseq",
+    "rt_sigaction", "rt_sigpending", "rt_sigprocmask", "rt_sigqueueinfo",
+    "rt_sigreturn", "rt_sigsuspend", "rt_sigtimedwait", "rt_tgsigqueueinfo",
+    "sched_get_priority_max", "sched_get_priority_min", "sched_getaffinity",
+    "sched_getattr", "sched_getparam", "sched_getscheduler",
+    "sched_rr_get_interval", "sched_setaffinity", "sched_setattr",
+    "sched_setparam", "sched_setscheduler", "sched_yield", "seccomp",
+    "select", "semctl", "semget", "semop", "semtimedop", "sendfile",
+    "sendmmsg", "sendmsg", "sendto", "set_robust_list", "set_thread_area",
+    "set_tid_address", "setfsgid", "setfsuid", "setgid", "setgroups",
+    "setitimer", "setpgid", "setpriority", "setregid", "setresgid",
+    "setresuid", "setreuid", "setrlimit", "setsid", "setsockopt", "setuid",
+    "setxattr", "shmat", "shmctl", "shmdt", "shmget", "shutdown",
+    "sigaltstack", "signalfd", "signalfd4", "socket", "socketpair", "splice",
+    "stat", "statfs", "statx", "symlink", "symlinkat", "sync",
+    "sync_file_range", "syncfs", "sysinfo", "tee", "tgkill", "time",
+    "timer_create", "timer_delete", "timer_getoverrun", "timer_gettime",
+    "timer_settime", "timerfd_create", "timerfd_gettime", "timerfd_settime",
+    "times", "tkill", "truncate", "umask", "uname", "unlink", "unlinkat",
+    "utime", "utimensat", "utimes", "vfork", "vmsplice", "wait4", "waitid",
+    "write", "writev",
+};
+
+#define DEFAULT_ALLOWLIST_SIZE \
+    (sizeof(default_allowlist) / sizeof(default_allowlist[0]))
+
+/**
+ * @brief Syscall allowed only for some values of one argument
+ *
+ * The syscall fails with EPERM when the masked argument equals one of the
+ * denied values or, without denied values, when any bit of the mask is set.
+ */
+typedef struct
+{
+    int nr; /**< Syscall number */
+    unsigned int arg; /**< Index of the checked argument */
+    uint32_t mask; /**< Bits of the argument to check */
+    uint32_t denied[2]; /**< Denied masked values */
+    unsigned int ndenied; /**< Number of denied values */
+} ArgCheck;
+
+// Applied whatever the profile, when the syscall is allowed at all
+static const ArgCheck arg_checks[] = {
+    // New namespaces would escape the cgroup and mount setup
+    { SYS_clone, 0, CLONE_NAMESPACE_FLAGS, { 0 }, 0 },
+    // Device nodes would bypass the whitelisted /dev; FIFOs, sockets and
+    // regular files are fine
+#ifdef SYS_mknod
+    { SYS_mknod, 1, S_IFMT, { S_IFCHR, S_IFBLK }, 2 },
+#endif
+    { SYS_mknodat, 2, S_IFMT, { S_IFCHR, S_IFBLK }, 2 },
+};
+
+#define ARG_CHECKS_SIZE (sizeof(arg_checks) / sizeof(arg_checks[0]))
+
+static size_t arg_check_size(const ArgCheck *check)
+{
+    return check->ndenied ? 5 + check->ndenied : 5;
+}
+
+// Emits a check that leaves the syscall number in the accumulator when the
+// syscall does not match
+static size_t emit_arg_check(struct sock_filter *insns, size_t pc,
+                             const ArgCheck *check)
+{
+    size_t len = arg_check_size(check);
+
+    insns[pc++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+                                               check->nr, 0, len - 1);
+    insns[pc++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+                                               SECCOMP_ARG_LO(check->arg));
+    if (check->ndenied == 0)
+    {
+        insns[pc++] = (struct sock_filter)BPF_JUMP(
+            BPF_JMP | BPF_JSET | BPF_K, check->mask, 1, 0);
+    }
+    else
+    {
+        insns[pc++] = (struct sock_filter)BPF_STMT(BPF_ALU | BPF_AND | BPF_K,
+                                                   check->mask);
+        for (unsigned int i = 0; i < check->ndenied; i++)
+        {
+            insns[pc++] = (struct sock_filter)BPF_JUMP(
+                BPF_JMP | BPF_JEQ | BPF_K, check->denied[i],
+                check->ndenied - i, 0);
+        }
+    }
+    insns[pc++] =
+        (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW);
+    insns[pc++] =
+        (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_EPERM);
+    return pc;
+}
+
+/**
+ * @brief Contiguous range of allowed syscall numbers
+ */
+typedef struct
+{
+    unsigned int lo;
+    unsigned int hi;
+} SyscallRange;
+
+static int compare_int(const void *a, const void *b)
+{
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+// Size of the search tree over ranges [first, last): each node holds one
+// range and the two subtrees, an empty subtree is a single deny.
+static size_t tree_size(size_t first, size_t last)
+{
+    if (first == last)
+        return 1;
+
+    size_t mid = first + (last - first) / 2;
+    return NODE_INSNS + tree_size(first, mid) + tree_size(mid + 1, last);
+}
+
+static size_t emit_tree(struct sock_filter *insns, size_t pc,
+                        const SyscallRange *ranges, size_t first, size_t last)
+{
+    if (first == last)
+    {
+        insns[pc] =
+            (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_DENY);
+        return pc + 1;
+    }
+
+    size_t mid = first + (last - first) / 2;
+    size_t right = pc + NODE_INSNS;
+    size_t left = right + tree_size(mid + 1, last);
+
+    // nr < lo: go left. The unconditional jump has a 32-bit offset, so the
+    // tree is not limited by the 8-bit offsets of conditional jumps.
+    insns[pc] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K,
+                                             ranges[mid].lo, 1, 0);
+    insns[pc + 1] =
+        (struct sock_filter)BPF_STMT(BPF_JMP | BPF_JA, left - (pc + 2));
+    // nr > hi: go right, otherwise the syscall is in the range
+    insns[pc + 2] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JGT | BPF_K,
+                                                 ranges[mid].hi, 1, 0);
+    insns[pc + 3] =
+        (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW);
+
+    pc = emit_tree(insns, right, ranges, mid + 1, last);
+    return emit_tree(insns, pc, ranges, first, mid);
+}
+
+SeccompFilter *seccomp_filter_compile(const int *syscalls, size_t count)
+{
+    int *sorted = malloc((count ? count : 1) * sizeof(int));
+    SyscallRange *ranges = malloc((count ? count : 1) * sizeof(SyscallRange));
+    if (!sorted || !ranges)
+    {
+        fprintf(stderr, "Error: malloc failed: %s\n", strerror(errno));
+        free(sorted);
+        free(ranges);
+        return NULL;
+    }
+
+    // Syscalls with an argument check are handled before the search.
+    // clone3 passes its flags in memory, which a filter cannot read, so it
+    // is always denied and libc falls back to clone.
+    size_t nsorted = 0;
+    int checked[ARG_CHECKS_SIZE] = { 0 };
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t k = 0;
+        while (k < ARG_CHECKS_SIZE && arg_checks[k].nr != syscalls[i])
+            k++;
+
+        if (k < ARG_CHECKS_SIZE)
+            checked[k] = 1;
+#ifdef SYS_clone3
+        else if (syscalls[i] == SYS_clone3)
+            continue;
+#endif
+        else
+            sorted[nsorted++] = syscalls[i];
+    }
+    qsort(sorted, nsorted, sizeof(int), compare_int);
+
+    // Merge consecutive syscall numbers into ranges
+    size_t nranges = 0;
+    for (size_t i = 0; i < nsorted; i++)
+    {
+        unsigned int nr = (unsigned int)sorted[i];
+        if (nranges > 0 && nr <= ranges[nranges - 1].hi + 1)
+        {
+            if (nr > ranges[nranges - 1].hi)
+                ranges[nranges - 1].hi = nr;
+            continue;
+        }
+        ranges[nranges].lo = nr;
+        ranges[nranges].hi = nr;
+        nranges++;
+    }
+    free(sorted);
+
+    struct sock_filter prologue[] = {
+        // Kill on foreign architectures, syscall numbers would not match
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, arch)),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, SECCOMP_AUDIT_ARCH, 1, 0),
+        BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_KILL_PROCESS),
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, nr)),
+#if defined(__x86_64__)
+        BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, X32_SYSCALL_BIT, 0, 1),
+        BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_DENY),
+#endif
+    };
+    size_t prologue_len = sizeof(prologue) / sizeof(prologue[0]);
+
+    size_t len = prologue_len + tree_size(0, nranges);
+    for (size_t k = 0; k < ARG_CHECKS_SIZE; k++)
+    {
+        if (checked[k])
+            len += arg_check_size(&arg_checks[k]);
+    }
+    if (len > BPF_MAXINSNS)
+    {
+        fprintf(stderr, "Error: seccomp profile too large (%zu instructions)\n",
+                len);
+        free(ranges);
+        return NULL;
+    }
+
+    SeccompFilter *filter = malloc(sizeof(SeccompFilter));
+    if (!filter)
+    {
+        fprintf(stderr, "Error: malloc failed: %s\n", strerror(errno));
+        free(ranges);
+        return NULL;
+    }
+
+    filter->insns = malloc(len * sizeof(struct sock_filter));
+    if (!filter->insns)
+    {
+        fprintf(stderr, "Error: malloc failed: %s\n", strerror(errno));
+        free(filter);
+        free(ranges);
+        return NULL;
+    }
+
+    memcpy(filter->insns, prologue, sizeof(prologue));
+    size_t pc = prologue_len;
+    for (size_t k = 0; k < ARG_CHECKS_SIZE; k++)
+    {
+        if (checked[k])
+            pc = emit_arg_check(filter->insns, pc, &arg_checks[k]);
+    }
+    emit_tree(filter->insns, pc, ranges, 0, nranges);
+    filter->len = (unsigned short)len;
+
+    free(ranges);
+    return filter;
+}
+
+static int *load_default(size_t *count)
+{
+    int *syscalls = malloc(DEFAULT_ALLOWLIST_SIZE * sizeof(int));
+    if (!syscalls)
+    {
+        fprintf(stderr, "Error: malloc failed: %s\n", strerror(errno));
+        return NULL;
+    }
+
+    *count = 0;
+    for (size_t i = 0; i < DEFAULT_ALLOWLIST_SIZE; i++)
+    {
+        int nr = syscall_lookup(default_allowlist[i]);
+        if (nr >= 0)
+            syscalls[(*count)++] = nr;
+    }
+
+    return syscalls;
+}
+
+static int *load_file(const char *path, size_t *count)
+{
+    FILE *f = fopen(path, "r");
+    if (!f)
+    {
+        fprintf(stderr, "Error: Failed to open seccomp profile '%s': %s\n",
+                path, strerror(errno));
+        return NULL;
+    }
+
+    size_t capacity = 64;
+    int *syscalls = malloc(capacity * sizeof(int));
+    if (!syscalls)
+    {
+        fprintf(stderr, "Error: malloc failed: %s\n", strerror(errno));
+        fclose(f);
+        return NULL;
+    }
+
+    *count = 0;
+    char *line = NULL;
+    size_t line_size = 0;
+    size_t line_no = 0;
+    while (getline(&line, &line_size, f) != -1)
+    {
+        line_no++;
+
+        char *name = line;
+        while (isspace((unsigned char)*name))
+            name++;
+        char *end = name + strlen(name);
+        while (end > name && isspace((unsigned char)end[-1]))
+            *--end = '\0';
+
+        if (*name == '\0' || *name == '#')
+            continue;
+
+        int nr = syscall_lookup(name);
+        if (nr < 0)
+        {
+            fprintf(stderr, "Error: %s:%zu: unknown syscall '%s'\n", path,
+                    line_no, name);
+            free(line);
+            free(syscalls);
+            fclose(f);
+            return NULL;
+        }
+
+        if (*count == capacity)
+        {
+            capacity *= 2;
+            int *grown = realloc(syscalls, capacity * sizeof(int));
+            if (!grown)
+            {
+                fprintf(stderr, "Error: realloc failed: %s\n", strerror(errno));
+                free(line);
+                free(syscalls);
+                fclose(f);
+                return NULL;
+            }
+            syscalls = grown;
+        }
+        syscalls[(*count)++] = nr;
+    }
+
+    free(line);
+    fclose(f);
+    return syscalls;
+}
+
+SeccompFilter *seccomp_filter_create(const char *profile)
+{
+    size_t count = 0;
+    int *syscalls = strcmp(profile, SECCOMP_PROFILE_DEFAULT) == 0
+                        ? load_default(&count)
+                        : load_file(profile, &count);
+    if (!syscalls)
+        return NULL;
+
+    SeccompFilter *filter = seccomp_filter_compile(syscalls, count);
+    free(syscalls);
+    return filter;
+}
+
+int seccomp_filter_install(const SeccompFilter *filter, unsigned int flags)
+{
+    if (!filter)
+        return EXIT_FAILURE;
+
+    if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) != 0)
+    {
+        fprintf(stderr, "Error: prctl(PR_SET_NO_NEW_PRIVS) failed: %s\n",
+                strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    struct sock_fprog prog = {
+        .len = filter->len,
+        .filter = filter->insns,
+    };
+    if (syscall(SYS_seccomp, SECCOMP_SET_MODE_FILTER, flags, &prog) != 0)
+    {
+        fprintf(stderr, "Error: seccomp failed: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+void seccomp_filter_free(SeccompFilter *filter)
+{
+    if (filter)
+    {
+        free(filter->insns);
+        free(filter);
+    }
+}
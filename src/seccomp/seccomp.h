@@ -0,0 +1,77 @@
+/**
+ * @file seccomp.h
+ * @brief Seccomp-BPF syscall filtering
+ *
+ * A profile is an allowlist of syscalls; any other syscall fails with ENOSYS.
+ * An allowed clone still fails with EPERM when it creates namespaces, as do
+ * mknod and mknodat when they create device nodes. clone3 is always denied
+ * since its flags cannot be inspected. Only 64-bit architectures are
+ * supported.
+ * The allowlist is compiled into a balanced binary search over contiguous
+ * syscall number ranges, so every syscall made by the container is checked
+ * in O(log n) comparisons instead of walking a linear chain.
+ */
+
+#ifndef TINYDOCKER_SECCOMP_H
+#define TINYDOCKER_SECCOMP_H
+
+#include <linux/filter.h>
+#include <stddef.h>
+
+/** @brief Profile name selecting the built-in allowlist */
+#define SECCOMP_PROFILE_DEFAULT "default"
+
+/** @brief Profile name disabling syscall filtering */
+#define SECCOMP_PROFILE_UNCONFINED "unconfined"
+
+/**
+ * @brief Compiled seccomp filter
+ */
+typedef struct
+{
+    struct sock_filter *insns; /**< BPF program */
+    unsigned short len; /**< Number of instructions */
+} SeccompFilter;
+
+/**
+ * @brief Compile a seccomp filter from an allowlist of syscall numbers
+ *
+ * @param syscalls Allowed syscall numbers, in any order, duplicates allowed
+ * @param count Number of entries in syscalls
+ * @return Pointer to the compiled filter, or NULL on failure
+ */
+SeccompFilter *seccomp_filter_compile(const int *syscalls, size_t count);
+
+/**
+ * @brief Create a seccomp filter from a profile
+ *
+ * The profile is either SECCOMP_PROFILE_DEFAULT or the path to a file
+ * listing one allowed syscall name per line. Blank lines and lines starting
+ * with '#' are ignored. The profile must allow execve for the container
+ * command to start.
+ *
+ * @param profile Profile name or path
+ * @return Pointer to the compiled filter, or NULL on failure
+ */
+SeccompFilter *seccomp_filter_create(const char *profile);
+
+/**
+ * @brief Install a seccomp filter on the calling process
+ *
+ * Sets no_new_privs and loads the filter. The filter is inherited across
+ * fork and execve and cannot be removed.
+ *
+ * @param filter Pointer to the SeccompFilter structure
+ * @param flags SECCOMP_FILTER_FLAG_* flags (e.g. SPEC_ALLOW)
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ */
+int seccomp_filter_install(const SeccompFilter *filter, unsigned int flags);
+
+/**
+ * @brief Free resources associated with a seccomp filter
+ *
+ * @param filter Pointer to the SeccompFilter structure
+ */
+void seccomp_filter_free(SeccompFilter *filter);
+
+#endif // TINYDOCKER_SECCOMP_H
@@ -0,0 +1,31 @@
+#include "syscalls.h"
+
+#include <asm/unistd.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * @brief Syscall name and number pair
+ */
+typedef struct
+{
+    const char *name;
+    int nr;
+} SyscallName;
+
+// Generated at build time from <asm/unistd.h>, see the Makefile
+static const SyscallName syscall_names[] = {
+#include "syscall_names.h"
+};
+
+#define SYSCALL_NAMES_SIZE (sizeof(syscall_names) / sizeof(syscall_names[0]))
+
+int syscall_lookup(const char *name)
+{
+    for (size_t i = 0; i < SYSCALL_NAMES_SIZE; i++)
+    {
+        if (strcmp(syscall_names[i].name, name) == 0)
+            return syscall_names[i].nr;
+    }
+    return -1;
+}
@@ -0,0 +1,19 @@
+/**
+ * @file syscalls.h
+ * @brief Syscall name lookup for seccomp profiles
+ */
+
+#ifndef TINYDOCKER_SYSCALLS_H
+#define TINYDOCKER_SYSCALLS_H
+
+/**
+ * @brief Look up a syscall number by name
+ *
+ * Only syscalls available on the build architecture are known.
+ *
+ * @param name Syscall name, as in the kernel (e.g. "openat")
+ * @return Syscall number, or -1 if the name is unknown
+ */
+int syscall_lookup(const char *name);
+
+#endif // TINYDOCKER_SYSCALLS_H
@@ -0,0 +1,438 @@
+#define _GNU_SOURCE
+#include "state.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/random.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../cgroup/cgroup.h"
+#include "../utils/utils.h"
+
+#define STATE_MAGIC 0x54445354 // "TDST"
+#define STATE_VERSION 1
+#define STATE_HEADER_SIZE 64
+#define STATE_READ_RETRIES 1000
+
+typedef struct
+{
+    _Atomic uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t slot_size;
+} StateHeader;
+
+typedef struct
+{
+    // Own cache line so that launches claiming neighbouring slots do not
+    // slow down each other
+    _Alignas(64) _Atomic uint32_t owner; // PID of the writer, 0 if free
+    _Atomic uint32_t seq; // Odd while the record is being written
+    ContainerRecord record;
+} StateSlot;
+
+#define STATE_FILE_SIZE \
+    (STATE_HEADER_SIZE + STATE_MAX_RECORDS * sizeof(StateSlot))
+
+static StateSlot *state_slots(const StateStore *store)
+{
+    return (StateSlot *)((char *)store->map + STATE_HEADER_SIZE);
+}
+
+static void slot_write(StateSlot *slot, const ContainerRecord *record)
+{
+    // Start from an odd value even if a previous writer crashed mid-update
+    uint32_t seq =
+        atomic_load_explicit(&slot->seq, memory_order_relaxed) | 1;
+    atomic_store_explicit(&slot->seq, seq, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    if (record)
+        memcpy(&slot->record, record, sizeof(ContainerRecord));
+    else
+        memset(&slot->record, 0, sizeof(ContainerRecord));
+
+    atomic_store_explicit(&slot->seq, seq + 1, memory_order_release);
+}
+
+StateStore *state_open(const char *path, int writable)
+{
+    StateStore *store = malloc(sizeof(StateStore));
+    if (!store)
+    {
+        fprintf(stderr, "Error: malloc failed: %s\n", strerror(errno));
+        return NULL;
+    }
+
+    store->fd = -1;
+    store->map = NULL;
+    store->size = 0;
+    store->writable = writable;
+
+    if (writable && mkdir(STATE_DIR, 0755) == -1 && errno != EEXIST)
+    {
+        fprintf(stderr, "Error: mkdir %s failed: %s\n", STATE_DIR,
+                strerror(errno));
+        free(store);
+        return NULL;
+    }
+
+    store->fd = open(path, writable ? O_RDWR | O_CREAT | O_CLOEXEC
+                                    : O_RDONLY | O_CLOEXEC,
+                     0644);
+    if (store->fd == -1)
+    {
+        // Nothing was ever recorded
+        if (!writable && errno == ENOENT)
+            return store;
+        fprintf(stderr, "Error: open %s failed: %s\n", path, strerror(errno));
+        free(store);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(store->fd, &st) == -1)
+    {
+        fprintf(stderr, "Error: fstat %s failed: %s\n", path, strerror(errno));
+        state_close(store);
+        return NULL;
+    }
+
+    if ((size_t)st.st_size < STATE_FILE_SIZE)
+    {
+        // Concurrent creators all extend the file to the same size
+        if (!writable || ftruncate(store->fd, STATE_FILE_SIZE) == -1)
+        {
+            fprintf(stderr, "Error: %s is truncated\n", path);
+            state_close(store);
+            return NULL;
+        }
+    }
+
+    int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    store->map = mmap(NULL, STATE_FILE_SIZE, prot, MAP_SHARED, store->fd, 0);
+    if (store->map == MAP_FAILED)
+    {
+        fprintf(stderr, "Error: mmap %s failed: %s\n", path, strerror(errno));
+        store->map = NULL;
+        state_close(store);
+        return NULL;
+    }
+    store->size = STATE_FILE_SIZE;
+
+    StateHeader *header = store->map;
+    uint32_t magic = atomic_load_explicit(&header->magic, memory_order_acquire);
+    if (magic == 0 && writable)
+    {
+        header->version = STATE_VERSION;
+        header->capacity = STATE_MAX_RECORDS;
+        header->slot_size = sizeof(StateSlot);
+        atomic_store_explicit(&header->magic, STATE_MAGIC,
+                              memory_order_release);
+    }
+    else if (magic != 0
+             && (magic != STATE_MAGIC || header->version != STATE_VERSION
+                 || header->capacity != STATE_MAX_RECORDS
+                 || header->slot_size != sizeof(StateSlot)))
+    {
+        fprintf(stderr, "Error: %s has an incompatible format\n", path);
+        state_close(store);
+        return NULL;
+    }
+
+    return store;
+}
+
+int state_new_id(char *id)
+{
+    unsigned char bytes[STATE_ID_LEN / 2];
+    if (getrandom(bytes, sizeof(bytes), 0) != (ssize_t)sizeof(bytes))
+    {
+        fprintf(stderr, "Error: getrandom failed: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < sizeof(bytes); i++)
+        snprintf(id + 2 * i, 3, "%02x", bytes[i]);
+    return EXIT_SUCCESS;
+}
+
+int state_register(StateStore *store, const ContainerRecord *record)
+{
+    if (!store || !store->map || !store->writable)
+        return -1;
+
+    StateSlot *slots = state_slots(store);
+    uint32_t self = (uint32_t)getpid();
+
+    // Start probing at a PID-dependent slot to spread concurrent launches
+    size_t first = self % STATE_MAX_RECORDS;
+    for (size_t n = 0; n < STATE_MAX_RECORDS; n++)
+    {
+        size_t i = (first + n) % STATE_MAX_RECORDS;
+        uint32_t expected = 0;
+        if (atomic_compare_exchange_strong(&slots[i].owner, &expected, self))
+        {
+            slot_write(&slots[i], record);
+            return (int)i;
+        }
+    }
+
+    fprintf(stderr, "Error: state store full (%d containers)\n",
+            STATE_MAX_RECORDS);
+    return -1;
+}
+
+int state_update(StateStore *store, int slot, const ContainerRecord *record)
+{
+    if (!store || !store->map || slot < 0 || slot >= STATE_MAX_RECORDS)
+        return EXIT_FAILURE;
+
+    slot_write(&state_slots(store)[slot], record);
+    return EXIT_SUCCESS;
+}
+
+int state_release(StateStore *store, int slot)
+{
+    if (!store || !store->map || slot < 0 || slot >= STATE_MAX_RECORDS)
+        return EXIT_FAILURE;
+
+    StateSlot *s = &state_slots(store)[slot];
+    slot_write(s, NULL);
+    atomic_store_explicit(&s->owner, 0, memory_order_release);
+    return EXIT_SUCCESS;
+}
+
+int state_read(const StateStore *store, int slot, ContainerRecord *record)
+{
+    if (!store || !store->map || slot < 0 || slot >= STATE_MAX_RECORDS)
+        return 0;
+
+    StateSlot *s = &state_slots(store)[slot];
+    for (int retry = 0; retry < STATE_READ_RETRIES; retry++)
+    {
+        if (atomic_load_explicit(&s->owner, memory_order_acquire) == 0)
+            return 0;
+
+        uint32_t seq = atomic_load_explicit(&s->seq, memory_order_acquire);
+        if (seq & 1)
+        {
+            // The writer may have been preempted mid-update
+            sched_yield();
+            continue;
+        }
+
+        memcpy(record, &s->record, sizeof(ContainerRecord));
+        atomic_thread_fence(memory_order_acquire);
+
+        if (atomic_load_explicit(&s->seq, memory_order_relaxed) == seq)
+            return record->id[0] != '\0';
+    }
+
+    // The writer died mid-update, state_reconcile() frees the slot
+    return 0;
+}
+
+int state_find(const StateStore *store, const char *id,
+               ContainerRecord *record)
+{
+    size_t len = strlen(id);
+    int matches = 0;
+    ContainerRecord current;
+
+    for (int i = 0; i < STATE_MAX_RECORDS && len > 0; i++)
+    {
+        if (state_read(store, i, &current)
+            && strncmp(current.id, id, len) == 0)
+        {
+            *record = current;
+            matches++;
+        }
+    }
+
+    return matches == 1 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int state_process_alive(pid_t pid, unsigned long long start_time)
+{
+    // A start time of 0 means the process had already exited when recorded
+    return pid > 0 && start_time != 0 && proc_start_time(pid) == start_time;
+}
+
+static void reconcile_slot(StateStore *store, int slot)
+{
+    StateSlot *s = &state_slots(store)[slot];
+    uint32_t owner = atomic_load_explicit(&s->owner, memory_order_acquire);
+    ContainerRecord record;
+
+    if (owner == 0)
+        return;
+
+    uint32_t self = (uint32_t)getpid();
+    if (!state_read(store, slot, &record))
+    {
+        // Claimed but never written, or torn by a writer that died
+        if (kill(owner, 0) == -1 && errno == ESRCH
+            && atomic_compare_exchange_strong(&s->owner, &owner, self))
+            state_release(store, slot);
+        return;
+    }
+
+    // Supervisor still alive, or another process is reconciling the slot
+    if (state_process_alive(record.supervisor_pid,
+                            record.supervisor_start_time))
+        return;
+    if (owner != (uint32_t)record.supervisor_pid && kill(owner, 0) == 0)
+        return;
+
+    if (!atomic_compare_exchange_strong(&s->owner, &owner, self))
+        return;
+
+    if (state_process_alive(record.pid, record.start_time))
+    {
+        record.status = STATE_ORPHANED;
+        slot_write(s, &record);
+        // Hand the slot back to the dead supervisor so that it is checked
+        // again once the container exits
+        atomic_store_explicit(&s->owner, (uint32_t)record.supervisor_pid,
+                              memory_order_release);
+        return;
+    }
+
+    if (rmdir(record.cgroup_path) == -1 && errno != ENOENT)
+    {
+        fprintf(stderr, "Warning: failed to remove stale cgroup %s: %s\n",
+                record.cgroup_path, strerror(errno));
+    }
+    state_release(store, slot);
+}
+
+int state_reconcile(StateStore *store)
+{
+    if (!store || !store->map || !store->writable)
+        return EXIT_FAILURE;
+
+    // Only slots whose owner is gone need attention. Owners whose PID was
+    // reused are left to state_prune().
+    StateSlot *slots = state_slots(store);
+    for (int i = 0; i < STATE_MAX_RECORDS; i++)
+    {
+        uint32_t owner =
+            atomic_load_explicit(&slots[i].owner, memory_order_relaxed);
+        if (owner != 0 && kill(owner, 0) == -1 && errno == ESRCH)
+            reconcile_slot(store, i);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static int compare_id(const void *a, const void *b)
+{
+    return strcmp(a, b);
+}
+
+int state_prune(StateStore *store)
+{
+    if (!store || !store->map || !store->writable)
+        return EXIT_FAILURE;
+
+    for (int i = 0; i < STATE_MAX_RECORDS; i++)
+        reconcile_slot(store, i);
+
+    // List the control groups before snapshotting the records: a launch
+    // publishes its record before creating its control group, so every
+    // listed control group of a live launch is found in the snapshot
+    DIR *dir = opendir(CGROUP_BASE_PATH);
+    if (!dir)
+        return EXIT_SUCCESS;
+
+    size_t nnames = 0;
+    size_t capacity = 64;
+    char(*names)[STATE_ID_LEN + 1] = malloc(capacity * sizeof(*names));
+    char(*ids)[STATE_ID_LEN + 1] = malloc(STATE_MAX_RECORDS * sizeof(*ids));
+    if (!names || !ids)
+    {
+        fprintf(stderr, "Error: malloc failed: %s\n", strerror(errno));
+        free(names);
+        free(ids);
+        closedir(dir);
+        return EXIT_FAILURE;
+    }
+
+    struct dirent *entry;
+    size_t prefix_len = strlen(CGROUP_NAME_PREFIX);
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if (strncmp(entry->d_name, CGROUP_NAME_PREFIX, prefix_len) != 0
+            || strlen(entry->d_name + prefix_len) != STATE_ID_LEN)
+            continue;
+
+        if (nnames == capacity)
+        {
+            capacity *= 2;
+            void *grown = realloc(names, capacity * sizeof(*names));
+            if (!grown)
+            {
+                fprintf(stderr, "Error: realloc failed: %s\n",
+                        strerror(errno));
+                free(names);
+                free(ids);
+                closedir(dir);
+                return EXIT_FAILURE;
+            }
+            names = grown;
+        }
+        memcpy(names[nnames++], entry->d_name + prefix_len, sizeof(*names));
+    }
+    closedir(dir);
+
+    size_t count = 0;
+    ContainerRecord record;
+    for (int i = 0; i < STATE_MAX_RECORDS; i++)
+    {
+        if (state_read(store, i, &record))
+            memcpy(ids[count++], record.id, sizeof(*ids));
+    }
+    qsort(ids, count, sizeof(*ids), compare_id);
+
+    // Control groups left behind by a supervisor that crashed before
+    // registering, or whose record was lost
+    for (size_t i = 0; i < nnames; i++)
+    {
+        if (bsearch(names[i], ids, count, sizeof(*ids), compare_id))
+            continue;
+
+        // Fails with EBUSY if processes are still attached
+        char path[sizeof(CGROUP_BASE_PATH) + sizeof(CGROUP_NAME_PREFIX)
+                  + STATE_ID_LEN];
+        snprintf(path, sizeof(path), "%s/%s%s", CGROUP_BASE_PATH,
+                 CGROUP_NAME_PREFIX, names[i]);
+        rmdir(path);
+    }
+
+    free(names);
+    free(ids);
+    return EXIT_SUCCESS;
+}
+
+void state_close(StateStore *store)
+{
+    if (store)
+    {
+        if (store->map)
+            munmap(store->map, store->size);
+        if (store->fd != -1)
+            close(store->fd);
+        free(store);
+    }
+}
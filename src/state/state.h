@@ -0,0 +1,189 @@
+/**
+ * @file state.h
+ * @brief Persistent container state store
+ *
+ * Container records live in a fixed-size array of slots in a memory-mapped
+ * file shared by every tinydocker process. A launch claims a free slot with
+ * a compare-and-swap on its owner field and is the only writer of that slot
+ * afterwards. Each slot is protected by a sequence counter (seqlock): the
+ * writer makes it odd while updating the record, and readers retry if it was
+ * odd or changed during their copy. Listing containers therefore never takes
+ * a lock and never blocks a launch.
+ */
+
+#ifndef TINYDOCKER_STATE_H
+#define TINYDOCKER_STATE_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/** @brief Directory holding the state file */
+#define STATE_DIR "/run/tinydocker"
+
+/** @brief Path to the state file */
+#define STATE_PATH STATE_DIR "/state"
+
+/** @brief Maximum number of container records */
+#define STATE_MAX_RECORDS 4096
+
+/** @brief Length of a container ID, in hex characters */
+#define STATE_ID_LEN 12
+
+/** @brief Size of the path fields of a record */
+#define STATE_PATH_MAX 256
+
+/** @brief Size of the hostname field of a record */
+#define STATE_HOSTNAME_MAX 65
+
+/**
+ * @brief Container status
+ */
+typedef enum
+{
+    STATE_CREATED = 1, /**< Container is being set up */
+    STATE_RUNNING, /**< Container and supervisor are running */
+    STATE_ORPHANED /**< Container outlived its supervisor */
+} ContainerStatus;
+
+/**
+ * @brief Container record
+ */
+typedef struct
+{
+    char id[STATE_ID_LEN + 1]; /**< Container ID */
+    pid_t pid; /**< Host PID of the container init */
+    unsigned long long start_time; /**< Start time of the container init */
+    pid_t supervisor_pid; /**< PID of the tinydocker process */
+    unsigned long long supervisor_start_time; /**< Start time of supervisor */
+    char cgroup_path[STATE_PATH_MAX]; /**< Path to the control group */
+    char rootfs[STATE_PATH_MAX]; /**< Path to the root filesystem */
+    char hostname[STATE_HOSTNAME_MAX]; /**< Hostname of the container */
+    int max_cpus; /**< Maximum number of CPUs allowed */
+    long max_memory; /**< Maximum memory allowed in bytes */
+    long long created_at; /**< Creation time, in seconds since the epoch */
+    int status; /**< ContainerStatus */
+} ContainerRecord;
+
+/**
+ * @brief Open state store
+ */
+typedef struct
+{
+    int fd; /**< File descriptor of the state file */
+    void *map; /**< Mapping of the state file */
+    size_t size; /**< Size of the mapping */
+    int writable; /**< Non-zero if opened for writing */
+} StateStore;
+
+/**
+ * @brief Open the state store
+ *
+ * When writable, the state directory and file are created if needed. When
+ * read-only and the file does not exist yet, an empty store is returned.
+ *
+ * @param path Path to the state file
+ * @param writable Non-zero to open for writing
+ * @return Pointer to the StateStore structure, or NULL on failure
+ */
+StateStore *state_open(const char *path, int writable);
+
+/**
+ * @brief Generate a random container ID
+ *
+ * @param id Buffer of at least STATE_ID_LEN + 1 bytes
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ */
+int state_new_id(char *id);
+
+/**
+ * @brief Add a container record
+ *
+ * Claims a free slot owned by the calling process and publishes the record.
+ *
+ * @param store Pointer to the StateStore structure
+ * @param record Record to publish
+ * @return Slot index on success, -1 on failure
+ */
+int state_register(StateStore *store, const ContainerRecord *record);
+
+/**
+ * @brief Replace the record of an owned slot
+ *
+ * @param store Pointer to the StateStore structure
+ * @param slot Slot index returned by state_register()
+ * @param record New record
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ */
+int state_update(StateStore *store, int slot, const ContainerRecord *record);
+
+/**
+ * @brief Remove the record of an owned slot
+ *
+ * @param store Pointer to the StateStore structure
+ * @param slot Slot index returned by state_register()
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ */
+int state_release(StateStore *store, int slot);
+
+/**
+ * @brief Read a record without locking
+ *
+ * @param store Pointer to the StateStore structure
+ * @param slot Slot index, from 0 to STATE_MAX_RECORDS - 1
+ * @param record Buffer receiving a consistent copy of the record
+ * @return 1 if the slot holds a record, 0 if it is free
+ */
+int state_read(const StateStore *store, int slot, ContainerRecord *record);
+
+/**
+ * @brief Find a record by ID or unique ID prefix
+ *
+ * @param store Pointer to the StateStore structure
+ * @param id Container ID or prefix
+ * @param record Buffer receiving the record
+ * @return EXIT_SUCCESS if exactly one record matches, EXIT_FAILURE otherwise
+ */
+int state_find(const StateStore *store, const char *id,
+               ContainerRecord *record);
+
+/**
+ * @brief Check that a recorded process is still the same process
+ *
+ * @param pid Recorded PID
+ * @param start_time Recorded start time, 0 if the process had already exited
+ * @return Non-zero if the process is alive and its PID was not reused
+ */
+int state_process_alive(pid_t pid, unsigned long long start_time);
+
+/**
+ * @brief Reconcile the records of dead owners
+ *
+ * Cheap enough to run on every launch: only slots whose owner process no
+ * longer exists are inspected. Records whose supervisor and container are
+ * gone are removed along with their control group, and records whose
+ * container outlived its supervisor are marked orphaned.
+ *
+ * @param store Pointer to the StateStore structure, opened for writing
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ */
+int state_reconcile(StateStore *store);
+
+/**
+ * @brief Reconcile every record and remove stray control groups
+ *
+ * Like state_reconcile(), but also checks owners whose PID may have been
+ * reused, and removes empty tinydocker control groups without a record.
+ *
+ * @param store Pointer to the StateStore structure, opened for writing
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ */
+int state_prune(StateStore *store);
+
+/**
+ * @brief Close the state store
+ *
+ * @param store Pointer to the StateStore structure
+ */
+void state_close(StateStore *store);
+
+#endif // TINYDOCKER_STATE_H
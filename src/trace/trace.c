@@ -0,0 +1,202 @@
+#define _GNU_SOURCE
+#include "trace.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/** @brief Worst-case size of one serialized event */
+#define TRACE_EVENT_JSON_MAX 192
+
+typedef struct
+{
+    const char *name;
+    uint64_t start;
+    uint64_t end;
+    char phase;
+} TraceEvent;
+
+int trace_enabled = 0;
+
+static int trace_fd = -1;
+static int trace_pid; // Host PID of the supervisor, shared by every process
+static int trace_tid = 1; // Incremented for each process of the launch
+static const char *trace_role = "supervisor";
+static TraceEvent trace_events[TRACE_MAX_EVENTS];
+static atomic_uint trace_count;
+static char trace_json[(TRACE_MAX_EVENTS + 1) * TRACE_EVENT_JSON_MAX];
+
+int trace_open(const char *path, const char *id)
+{
+    // A directory receives one file per launch, so that concurrent
+    // supervisors never write to the same file
+    char file[PATH_MAX];
+    struct stat st;
+    if (stat(path, &st) == 0 && S_ISDIR(st.st_mode))
+    {
+        int ret =
+            snprintf(file, sizeof(file), "%s/tinydocker-%s.json", path, id);
+        if (ret < 0 || (size_t)ret >= sizeof(file))
+        {
+            fprintf(stderr, "Path too long\n");
+            return EXIT_FAILURE;
+        }
+        path = file;
+    }
+
+    trace_fd = open(path, O_WRONLY | O_CREAT | O_EXCL | O_APPEND | O_CLOEXEC,
+                    0644);
+    if (trace_fd == -1)
+    {
+        fprintf(stderr, "Error: open %s failed: %s\n", path, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    // PIDs read inside the container are namespace-local, so every process
+    // of the launch is shown under the supervisor PID with its own thread.
+    // The closing bracket is optional in the JSON array format, which lets
+    // every process append its events independently.
+    trace_pid = getpid();
+    char header[TRACE_EVENT_JSON_MAX];
+    int len = snprintf(header, sizeof(header),
+                       "[\n{\"name\":\"process_name\",\"ph\":\"M\","
+                       "\"pid\":%d,\"args\":{\"name\":\"tinydocker %s\"}},\n",
+                       trace_pid, id);
+    if (len < 0 || write(trace_fd, header, (size_t)len) != len)
+    {
+        fprintf(stderr, "Error: write %s failed: %s\n", path, strerror(errno));
+        close(trace_fd);
+        trace_fd = -1;
+        return EXIT_FAILURE;
+    }
+
+    atomic_store(&trace_count, 0);
+    trace_enabled = 1;
+    return EXIT_SUCCESS;
+}
+
+void trace_process_start(const char *role)
+{
+    trace_role = role;
+    trace_tid++;
+    atomic_store_explicit(&trace_count, 0, memory_order_relaxed);
+}
+
+uint64_t trace_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void trace_push(const char *name, uint64_t start, uint64_t end,
+                       char phase)
+{
+    unsigned int idx =
+        atomic_fetch_add_explicit(&trace_count, 1, memory_order_relaxed);
+    if (idx >= TRACE_MAX_EVENTS)
+        return;
+
+    trace_events[idx].name = name;
+    trace_events[idx].start = start;
+    trace_events[idx].end = end;
+    trace_events[idx].phase = phase;
+}
+
+void trace_record(const char *name, uint64_t start, uint64_t end)
+{
+    trace_push(name, start, end, 'X');
+}
+
+void trace_instant(const char *name)
+{
+    if (!trace_enabled)
+        return;
+    uint64_t now = trace_now();
+    trace_push(name, now, now, 'i');
+}
+
+int trace_flush(void)
+{
+    if (!trace_enabled || trace_fd == -1)
+        return EXIT_SUCCESS;
+
+    unsigned int count =
+        atomic_exchange_explicit(&trace_count, 0, memory_order_acquire);
+    if (count > TRACE_MAX_EVENTS)
+    {
+        fprintf(stderr, "Warning: trace buffer full, %u events dropped\n",
+                count - TRACE_MAX_EVENTS);
+        count = TRACE_MAX_EVENTS;
+    }
+
+    size_t len = 0;
+    int ret = snprintf(trace_json, sizeof(trace_json),
+                       "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,"
+                       "\"tid\":%d,\"args\":{\"name\":\"%s\"}},\n",
+                       trace_pid, trace_tid, trace_role);
+    if (ret < 0)
+        return EXIT_FAILURE;
+    len = (size_t)ret;
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        const TraceEvent *ev = &trace_events[i];
+        uint64_t dur = ev->end - ev->start;
+
+        if (ev->phase == 'X')
+        {
+            ret = snprintf(
+                trace_json + len, sizeof(trace_json) - len,
+                "{\"name\":\"%s\",\"cat\":\"tinydocker\",\"ph\":\"X\","
+                "\"ts\":%llu.%03llu,\"dur\":%llu.%03llu,\"pid\":%d,"
+                "\"tid\":%d},\n",
+                ev->name, (unsigned long long)(ev->start / 1000),
+                (unsigned long long)(ev->start % 1000),
+                (unsigned long long)(dur / 1000),
+                (unsigned long long)(dur % 1000), trace_pid, trace_tid);
+        }
+        else
+        {
+            ret = snprintf(
+                trace_json + len, sizeof(trace_json) - len,
+                "{\"name\":\"%s\",\"cat\":\"tinydocker\",\"ph\":\"i\","
+                "\"s\":\"p\",\"ts\":%llu.%03llu,\"pid\":%d,\"tid\":%d},\n",
+                ev->name, (unsigned long long)(ev->start / 1000),
+                (unsigned long long)(ev->start % 1000), trace_pid,
+                trace_tid);
+        }
+
+        if (ret < 0 || (size_t)ret >= sizeof(trace_json) - len)
+            break;
+        len += (size_t)ret;
+    }
+
+    // A single write on an O_APPEND descriptor keeps the events of
+    // concurrent processes from interleaving.
+    if (write(trace_fd, trace_json, len) != (ssize_t)len)
+    {
+        fprintf(stderr, "Error: trace write failed: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+void trace_close(void)
+{
+    if (trace_fd == -1)
+        return;
+
+    trace_flush();
+    close(trace_fd);
+    trace_fd = -1;
+    trace_enabled = 0;
+}
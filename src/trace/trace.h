@@ -0,0 +1,134 @@
+/**
+ * @file trace.h
+ * @brief Lifecycle tracing in Chrome trace / Perfetto JSON format
+ *
+ * Every process involved in running a container (the supervisor, the
+ * container init and the container process) records monotonic-clock spans
+ * into its own fixed-size buffer. Each process appends its buffer to the
+ * shared trace file with a single write, so the resulting file can be opened
+ * directly in chrome://tracing or https://ui.perfetto.dev. All processes of
+ * a launch are shown as threads of the supervisor PID, since PIDs read
+ * inside the container are namespace-local.
+ *
+ * Every span also fires a USDT probe (tinydocker:phase__begin and
+ * tinydocker:phase__end), so external tracers can attach even when file
+ * tracing is disabled. Building without <sys/sdt.h> requires NO_USDT=1,
+ * which defines TRACE_NO_USDT and leaves the probes out.
+ */
+
+#ifndef TINYDOCKER_TRACE_H
+#define TINYDOCKER_TRACE_H
+
+#include <stdint.h>
+
+/** @brief Environment variable holding the trace file path */
+#define TRACE_ENV_VAR "TINYDOCKER_TRACE"
+
+/** @brief Maximum number of events buffered per process */
+#define TRACE_MAX_EVENTS 256
+
+#ifndef TRACE_NO_USDT
+#    include <sys/sdt.h>
+#    define TRACE_PROBE_BEGIN(name) \
+        DTRACE_PROBE1(tinydocker, phase__begin, name)
+#    define TRACE_PROBE_END(name) DTRACE_PROBE1(tinydocker, phase__end, name)
+#else
+#    define TRACE_PROBE_BEGIN(name) ((void)(name))
+#    define TRACE_PROBE_END(name) ((void)(name))
+#endif
+
+/** @brief Non-zero when spans are recorded to the trace file */
+extern int trace_enabled;
+
+/**
+ * @brief Open the trace file and enable tracing
+ *
+ * Creates the file, failing if it already exists, and writes the opening
+ * bracket of the JSON array. When the path is a directory, the trace is
+ * written to tinydocker-ID.json inside it. The file descriptor is inherited
+ * by the container processes but closed on exec.
+ *
+ * @param path Path to the trace file or to a directory
+ * @param id Container ID
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ */
+int trace_open(const char *path, const char *id);
+
+/**
+ * @brief Reset the event buffer for a newly created process
+ *
+ * Must be called first thing after clone or fork so that events inherited
+ * from the parent are not written twice, and so that the process gets its
+ * own thread in the trace.
+ *
+ * @param role Thread name shown in the trace viewer (string literal)
+ */
+void trace_process_start(const char *role);
+
+/**
+ * @brief Read the monotonic clock
+ *
+ * @return Current CLOCK_MONOTONIC time in nanoseconds
+ */
+uint64_t trace_now(void);
+
+/**
+ * @brief Record a completed span
+ *
+ * Lock-free: the buffer slot is reserved with an atomic increment. Events
+ * beyond TRACE_MAX_EVENTS are dropped.
+ *
+ * @param name Span name (string literal)
+ * @param start Start time in nanoseconds, as returned by trace_begin()
+ * @param end End time in nanoseconds
+ */
+void trace_record(const char *name, uint64_t start, uint64_t end);
+
+/**
+ * @brief Record an instant event
+ *
+ * @param name Event name (string literal)
+ */
+void trace_instant(const char *name);
+
+/**
+ * @brief Append the buffered events of this process to the trace file
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ */
+int trace_flush(void);
+
+/**
+ * @brief Flush pending events and close the trace file
+ */
+void trace_close(void);
+
+/**
+ * @brief Begin a span
+ *
+ * @param name Span name (string literal)
+ * @return Start timestamp to pass to trace_end(), or 0 when disabled
+ */
+static inline uint64_t trace_begin(const char *name)
+{
+    TRACE_PROBE_BEGIN(name);
+    if (__builtin_expect(!trace_enabled, 1))
+        return 0;
+    return trace_now();
+}
+
+/**
+ * @brief End a span started with trace_begin()
+ *
+ * @param name Span name (string literal)
+ * @param start Value returned by trace_begin()
+ */
+static inline void trace_end(const char *name, uint64_t start)
+{
+    TRACE_PROBE_END(name);
+    if (__builtin_expect(!trace_enabled, 1))
+        return;
+    trace_record(name, start, trace_now());
+}
+
+#endif // TINYDOCKER_TRACE_H
@@ -27,4 +27,40 @@ int write_str_to_file(const char *path, const char *fmt, ...)
     va_end(args);
     fclose(f);
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
+
+unsigned long long proc_start_time(pid_t pid)
+{
+    char path[32];
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return 0;
+
+    char buf[1024];
+    size_t len = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[len] = '\0';
+
+    // The command name may contain spaces and parentheses, so start parsing
+    // after the last ')'. starttime is the 19th field after the state.
+    char *p = strrchr(buf, ')');
+    char state = '\0';
+    unsigned long long start_time = 0;
+    if (!p
+        || sscanf(p + 1,
+                  " %c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %*u %*u %*d %*d"
+                  " %*d %*d %*d %*d %llu",
+                  &state, &start_time)
+               != 2)
+    {
+        return 0;
+    }
+
+    // An exited process waiting to be reaped is not running
+    if (state == 'Z' || state == 'X')
+        return 0;
+
+    return start_time;
+}
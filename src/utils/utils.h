@@ -6,6 +6,8 @@
 #ifndef TINYDOCKER_UTILS_H
 #define TINYDOCKER_UTILS_H
 
+#include <sys/types.h>
+
 /**
  * @brief Write a formatted string to a file
  *
@@ -19,4 +21,16 @@
  */
 int write_str_to_file(const char *path, const char *fmt, ...);
 
+/**
+ * @brief Get the start time of a process
+ *
+ * Reads the starttime field of /proc/PID/stat. Together with the PID, it
+ * identifies a process across PID reuse, e.g. before calling pidfd_open.
+ *
+ * @param pid Process ID
+ * @return Start time in clock ticks since boot, or 0 if there is no such
+ * process or it has exited
+ */
+unsigned long long proc_start_time(pid_t pid);
+
 #endif // TINYDOCKER_UTILS_H
\ No newline at end of file